@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// One executable arena for a set of hooks, reserved next to the module they patch and filled front to back with
+// cache line aligned blocks, so hot hook code shares a few pages and lines instead of one allocation each.
+// Placement and packing are written against a Pages layer so they run the same on VirtualAlloc in the game and mmap
+// on Linux (see tools/dafix-bench.cpp).
+namespace Arena
+{
+    constexpr std::size_t kCacheLine = 64;
+    constexpr std::size_t kRel32 = 0x7FFF'0000;     // Reach of a rel32 jmp, less a margin for the instruction itself
+    constexpr std::size_t kMaxAttempts = 4096;      // Placement probes on each side of the module
+
+    namespace Pages
+    {
+#if defined(_WIN32)
+        struct Win32
+        {
+            static std::size_t Granularity()
+            {
+                static const std::size_t granularity = [] {
+                    SYSTEM_INFO info;
+                    GetSystemInfo(&info);
+                    return static_cast<std::size_t>(info.dwAllocationGranularity);
+                }();
+                return granularity;
+            }
+
+            // RWX memory at exactly address, nullptr if anything is there already
+            static std::uint8_t* Reserve(std::uint8_t* address, std::size_t size)
+            {
+                return static_cast<std::uint8_t*>(VirtualAlloc(address, size, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+            }
+
+            static void Release(std::uint8_t* address, std::size_t)
+            {
+                VirtualFree(address, 0, MEM_RELEASE);
+            }
+        };
+
+        using Native = Win32;
+#else
+        struct Posix
+        {
+            static std::size_t Granularity()
+            {
+                static const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+                return pageSize;
+            }
+
+            // Without MAP_FIXED_NOREPLACE (Linux < 4.17) the address is only a hint, a mapping elsewhere is given back
+            static std::uint8_t* Reserve(std::uint8_t* address, std::size_t size)
+            {
+#if defined(MAP_FIXED_NOREPLACE)
+                constexpr int kFlags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE;
+#else
+                constexpr int kFlags = MAP_PRIVATE | MAP_ANONYMOUS;
+#endif
+                void* result = mmap(address, size, PROT_READ | PROT_WRITE | PROT_EXEC, kFlags, -1, 0);
+                if (result == MAP_FAILED)
+                    return nullptr;
+                if (result != address) {
+                    munmap(result, size);
+                    return nullptr;
+                }
+                return static_cast<std::uint8_t*>(result);
+            }
+
+            static void Release(std::uint8_t* address, std::size_t size)
+            {
+                munmap(address, size);
+            }
+        };
+
+        using Native = Posix;
+#endif
+    }
+
+    struct Block
+    {
+        std::string name;
+        std::size_t offset = 0;
+        std::size_t size = 0;
+    };
+
+    // Pages provides Granularity(), Reserve(address, size) returning exactly address or nullptr, and Release(address, size)
+    template<typename Pages>
+    class Arena
+    {
+    public:
+        Arena() = default;
+        // Frees the code, so an arena hooks still jump into must outlive them (see HookSet)
+        ~Arena() { Release(); }
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // Reserves capacity bytes within maxDistance of every byte of [low, high), trying granularity steps outward
+        // from just past each end of the range, nearest first
+        bool Reserve(const std::uint8_t* low, const std::uint8_t* high, std::size_t capacity, std::size_t maxDistance = kRel32)
+        {
+            Release();
+            const std::size_t granularity = Pages::Granularity();
+            capacity = (capacity + granularity - 1) / granularity * granularity;
+            const auto begin = reinterpret_cast<std::uintptr_t>(low);
+            const auto end = reinterpret_cast<std::uintptr_t>(high);
+            const std::uintptr_t above = (end + granularity - 1) / granularity * granularity;
+            const std::uintptr_t below = begin >= capacity ? (begin - capacity) / granularity * granularity : 0;
+
+            attempts = 0;
+            for (std::size_t step = 0; step < kMaxAttempts; ++step) {
+                const std::uintptr_t offset = step * granularity;
+                std::uintptr_t candidates[2] = {};
+                // Above the range: its far end still reachable from low, without wrapping past the top of the address space
+                if (above + offset + capacity > above && above + offset + capacity - begin <= maxDistance)
+                    candidates[0] = above + offset;
+                // Below the range: high still reachable from its start, which stays above the null page
+                if (below >= offset + granularity && end - (below - offset) <= maxDistance)
+                    candidates[1] = below - offset;
+                if (!candidates[0] && !candidates[1])
+                    break;
+
+                for (std::uintptr_t candidate : candidates) {
+                    if (!candidate)
+                        continue;
+                    ++attempts;
+                    if (std::uint8_t* result = Pages::Reserve(reinterpret_cast<std::uint8_t*>(candidate), capacity)) {
+                        base = result;
+                        size = capacity;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        // Next block aligned to alignment (a power of two), nullptr once the arena is full or was never reserved
+        std::uint8_t* Allocate(std::string name, std::size_t bytes, std::size_t alignment = kCacheLine)
+        {
+            std::size_t offset = (used + alignment - 1) & ~(alignment - 1);
+            if (!base || bytes == 0 || offset > size || size - offset < bytes)
+                return nullptr;
+            blocks.push_back({ std::move(name), offset, bytes });
+            used = offset + bytes;
+            return base + offset;
+        }
+
+        // Frees every block at once
+        void Release()
+        {
+            if (base)
+                Pages::Release(base, size);
+            base = nullptr;
+            size = 0;
+            used = 0;
+            blocks.clear();
+        }
+
+        bool Contains(const void* address) const
+        {
+            auto p = static_cast<const std::uint8_t*>(address);
+            return base && p >= base && p < base + size;
+        }
+
+        std::uint8_t* Base() const { return base; }
+        std::size_t Capacity() const { return size; }
+        std::size_t Used() const { return used; }
+        std::size_t Attempts() const { return attempts; }
+        const std::vector<Block>& Blocks() const { return blocks; }
+        explicit operator bool() const { return base != nullptr; }
+
+    private:
+        std::uint8_t* base = nullptr;
+        std::size_t size = 0;
+        std::size_t used = 0;
+        std::size_t attempts = 0;
+        std::vector<Block> blocks;
+    };
+}
@@ -0,0 +1,442 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+// Deferred-format logging for game threads.
+// ASYNC_LOG() pushes a fixed-size binary record (format id + raw arguments) into a lock-free ring and returns,
+// a background thread decodes records into text and hands them to a sink in batches.
+// Platform-neutral, the DLL's sink forwards decoded lines to spdlog (see Logging() in dllmain.cpp).
+namespace AsyncLog
+{
+    // Same order and values as spdlog::level::level_enum
+    enum class Level : std::uint8_t {
+        Trace,
+        Debug,
+        Info,
+        Warn,
+        Error,
+        Critical
+    };
+
+    enum class ArgType : std::uint8_t {
+        Int,
+        UInt,
+        Float,
+        Double,
+        Bool,
+        String  // Pointer only, the string must outlive the record (literals, long-lived globals)
+    };
+
+    constexpr std::size_t kMaxArgs = 6;
+    constexpr std::size_t kMaxFormats = 256;
+    constexpr std::size_t kRingSize = 1024;    // Records, power of two
+    constexpr std::uint16_t kNoFormat = 0xFFFF; // Format table full, the call site logs synchronously instead
+    static_assert(kMaxFormats < kNoFormat);
+
+    struct Record
+    {
+        std::int64_t timestamp = 0;             // system_clock ns since epoch at the call site
+        std::uint16_t format = 0;
+        std::uint8_t argCount = 0;
+        std::array<ArgType, kMaxArgs> types = {};
+        std::array<std::uint64_t, kMaxArgs> args = {};
+    };
+
+    struct Format
+    {
+        Level level = Level::Info;
+        const char* text = nullptr;
+    };
+
+    // Format strings are registered once per call site, records only carry the index.
+    // Returns kNoFormat once the table is full.
+    class Formats
+    {
+    public:
+        static std::uint16_t Register(Level level, const char* text)
+        {
+            auto& table = Instance();
+            std::lock_guard lock(table.mutex);
+            std::size_t id = table.count.load(std::memory_order_relaxed);
+            if (id >= kMaxFormats)
+                return kNoFormat;
+            table.formats[id] = { level, text };
+            table.count.store(id + 1, std::memory_order_release);
+            return static_cast<std::uint16_t>(id);
+        }
+
+        static Format Get(std::uint16_t id)
+        {
+            auto& table = Instance();
+            if (id >= table.count.load(std::memory_order_acquire))
+                return { Level::Error, "<unknown log format>" };
+            return table.formats[id];
+        }
+
+    private:
+        static Formats& Instance()
+        {
+            static Formats table;
+            return table;
+        }
+
+        std::mutex mutex;
+        std::array<Format, kMaxFormats> formats = {};
+        std::atomic<std::size_t> count = 0;
+    };
+
+    namespace Detail
+    {
+        template<typename T>
+        void Encode(Record& record, T value)
+        {
+            if (record.argCount >= kMaxArgs)
+                return;
+            std::size_t i = record.argCount++;
+            using U = std::decay_t<T>;
+            if constexpr (std::is_same_v<U, bool>) {
+                record.types[i] = ArgType::Bool;
+                record.args[i] = value ? 1 : 0;
+            }
+            else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+                record.types[i] = ArgType::Int;
+                record.args[i] = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+            }
+            else if constexpr (std::is_integral_v<U>) {
+                record.types[i] = ArgType::UInt;
+                record.args[i] = static_cast<std::uint64_t>(value);
+            }
+            else if constexpr (std::is_same_v<U, float>) {
+                record.types[i] = ArgType::Float;
+                std::uint32_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                record.args[i] = bits;
+            }
+            else if constexpr (std::is_same_v<U, double>) {
+                record.types[i] = ArgType::Double;
+                std::memcpy(&record.args[i], &value, sizeof(value));
+            }
+            else if constexpr (std::is_convertible_v<U, const char*>) {
+                record.types[i] = ArgType::String;
+                record.args[i] = reinterpret_cast<std::uintptr_t>(static_cast<const char*>(value));
+            }
+            else {
+                static_assert(std::is_enum_v<U>, "Unsupported ASYNC_LOG argument type.");
+                record.types[i] = ArgType::Int;
+                record.args[i] = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+            }
+        }
+
+        template<typename... Args>
+        constexpr const char* FormatText(const char* text, Args&&...) { return text; }
+
+        inline void Append(std::string& out, std::string_view spec, ArgType type, std::uint64_t arg)
+        {
+            // Spec is the part after ':', e.g. "d", "x", ".2f", "s" or empty
+            int precision = -1;
+            char presentation = spec.empty() ? '\0' : spec.back();
+            std::size_t dot = spec.find('.');
+            if (dot != std::string_view::npos) {
+                precision = 0;
+                for (std::size_t i = dot + 1; i < spec.size() && spec[i] >= '0' && spec[i] <= '9'; ++i)
+                    precision = precision * 10 + (spec[i] - '0');
+            }
+
+            char buffer[64];
+            std::to_chars_result result = { buffer, std::errc() };
+            switch (type) {
+            case ArgType::Int:
+                result = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<std::int64_t>(arg), presentation == 'x' || presentation == 'X' ? 16 : 10);
+                break;
+            case ArgType::UInt:
+                result = std::to_chars(buffer, buffer + sizeof(buffer), arg, presentation == 'x' || presentation == 'X' ? 16 : 10);
+                break;
+            case ArgType::Float:
+            case ArgType::Double: {
+                double value;
+                if (type == ArgType::Float) {
+                    float single;
+                    std::uint32_t bits = static_cast<std::uint32_t>(arg);
+                    std::memcpy(&single, &bits, sizeof(single));
+                    value = single;
+                    if (precision < 0) {
+                        // Shortest text that round-trips the float, same as fmt's "{}"
+                        result = std::to_chars(buffer, buffer + sizeof(buffer), single);
+                        break;
+                    }
+                }
+                else {
+                    std::memcpy(&value, &arg, sizeof(value));
+                }
+                result = precision < 0 ? std::to_chars(buffer, buffer + sizeof(buffer), value)
+                                       : std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, precision);
+                break;
+            }
+            case ArgType::Bool:
+                out += arg ? "true" : "false";
+                return;
+            case ArgType::String: {
+                const char* text = reinterpret_cast<const char*>(static_cast<std::uintptr_t>(arg));
+                out += text ? text : "(null)";
+                return;
+            }
+            }
+            if (presentation == 'X') {
+                for (char* c = buffer; c < result.ptr; ++c)
+                    *c = (*c >= 'a' && *c <= 'f') ? static_cast<char>(*c - 'a' + 'A') : *c;
+            }
+            out.append(buffer, result.ptr);
+        }
+    }
+
+    // Format record's arguments with text. Supports the subset of fmt syntax DAFix uses: {}, {:d}, {:x}, {:X}, {:s}, {:.Nf} and {{ }}.
+    inline void Decode(std::string_view text, const Record& record, std::string& out)
+    {
+        std::size_t arg = 0;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if (c == '{' && i + 1 < text.size() && text[i + 1] == '{') {
+                out += '{';
+                ++i;
+            }
+            else if (c == '}' && i + 1 < text.size() && text[i + 1] == '}') {
+                out += '}';
+                ++i;
+            }
+            else if (c == '{') {
+                std::size_t close = text.find('}', i);
+                if (close == std::string_view::npos) {
+                    out.append(text.substr(i));
+                    break;
+                }
+                std::string_view field = text.substr(i + 1, close - i - 1);
+                std::size_t colon = field.find(':');
+                std::string_view spec = colon == std::string_view::npos ? std::string_view() : field.substr(colon + 1);
+                if (arg < record.argCount) {
+                    Detail::Append(out, spec, record.types[arg], record.args[arg]);
+                    ++arg;
+                }
+                i = close;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+
+    inline void Decode(const Record& record, std::string& out)
+    {
+        Decode(Formats::Get(record.format).text, record, out);
+    }
+
+    inline std::string Decode(const Record& record)
+    {
+        std::string out;
+        Decode(record, out);
+        return out;
+    }
+
+    // Bounded lock-free multi-producer / single-consumer ring (Vyukov's bounded queue).
+    // A full ring drops the record instead of blocking the game thread, drops are counted.
+    template<typename T, std::size_t Size>
+    class BasicRing
+    {
+        static_assert(Size && (Size & (Size - 1)) == 0, "Ring size must be a power of two");
+
+    public:
+        BasicRing()
+        {
+            for (std::size_t i = 0; i < Size; ++i)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        bool TryPush(const T& record)
+        {
+            std::size_t position = enqueue.load(std::memory_order_relaxed);
+            for (;;) {
+                Slot& slot = slots[position & (Size - 1)];
+                std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+                if (difference == 0) {
+                    if (enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        slot.record = record;
+                        slot.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                else {
+                    position = enqueue.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Single consumer only
+        bool TryPop(T& record)
+        {
+            Slot& slot = slots[dequeue & (Size - 1)];
+            std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence != dequeue + 1)
+                return false;
+            record = slot.record;
+            slot.sequence.store(dequeue + Size, std::memory_order_release);
+            ++dequeue;
+            return true;
+        }
+
+        // Dropped records since the last call
+        std::size_t TakeDropped() { return dropped.exchange(0, std::memory_order_relaxed); }
+
+    private:
+        struct Slot
+        {
+            std::atomic<std::size_t> sequence = 0;
+            T record;
+        };
+
+        alignas(64) std::atomic<std::size_t> enqueue = 0;
+        alignas(64) std::size_t dequeue = 0;
+        alignas(64) std::atomic<std::size_t> dropped = 0;
+        std::array<Slot, Size> slots;
+    };
+
+    using Ring = BasicRing<Record, kRingSize>;
+
+    // Receives decoded lines on the background thread. flush is called once per batch.
+    struct Sink
+    {
+        std::function<void(Level level, std::int64_t timestamp, std::string_view message)> write;
+        std::function<void()> flush;
+    };
+
+    class Logger
+    {
+    public:
+        ~Logger() { Stop(); }
+
+        // Never destroyed, hooks may still log while the process exits
+        static Logger& Global()
+        {
+            static Logger* logger = new Logger;
+            return *logger;
+        }
+
+        static std::int64_t Now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        // text is the format string already registered as format, it is only there so ASYNC_LOG() can pass its arguments through unchanged
+        template<typename... Args>
+        void Log(std::uint16_t format, const char* text, Args... args)
+        {
+            static_assert(sizeof...(Args) <= kMaxArgs, "Too many ASYNC_LOG arguments.");
+            (void)text;
+            Record record;
+            record.timestamp = Now();
+            record.format = format;
+            (Detail::Encode(record, args), ...);
+            ring.TryPush(record);
+        }
+
+        // Fallback for call sites whose format could not be registered: format and write through the sink on the calling thread.
+        // The sink's write must be safe to call from any thread for this (the DLL's forwards to a thread-safe spdlog logger).
+        template<typename... Args>
+        void LogNow(Level level, const char* text, Args... args)
+        {
+            static_assert(sizeof...(Args) <= kMaxArgs, "Too many ASYNC_LOG arguments.");
+            Record record;
+            record.timestamp = Now();
+            (Detail::Encode(record, args), ...);
+            std::string message;
+            Decode(text, record, message);
+            if (sink.write)
+                sink.write(level, record.timestamp, message);
+        }
+
+        // Start the background thread, which drains the ring every interval
+        void Start(Sink sink, std::chrono::milliseconds interval = std::chrono::milliseconds(100))
+        {
+            Stop();
+            this->sink = std::move(sink);
+            bRunning.store(true, std::memory_order_release);
+            worker = std::thread([this, interval] {
+                while (bRunning.load(std::memory_order_acquire)) {
+                    Drain();
+                    std::this_thread::sleep_for(interval);
+                }
+                Drain();
+            });
+        }
+
+        // Stop the background thread after writing out everything pushed so far
+        void Stop()
+        {
+            if (!worker.joinable())
+                return;
+            bRunning.store(false, std::memory_order_release);
+            worker.join();
+        }
+
+        // Decode and write out everything in the ring, returns the number of records written.
+        // Only call from one thread at a time, the background thread does this when started.
+        std::size_t Drain()
+        {
+            std::size_t written = 0;
+            Record record;
+            while (ring.TryPop(record)) {
+                line.clear();
+                Decode(record, line);
+                if (sink.write)
+                    sink.write(Formats::Get(record.format).level, record.timestamp, line);
+                ++written;
+            }
+            std::size_t dropped = ring.TakeDropped();
+            droppedTotal += dropped;
+            if (dropped && sink.write) {
+                line = "Async Log: Ring full, dropped " + std::to_string(dropped) + " record(s).";
+                sink.write(Level::Warn, Now(), line);
+            }
+            if (sink.flush)
+                sink.flush();
+            return written;
+        }
+
+        // Records lost to a full ring, counted as they are reported by Drain()
+        std::size_t Dropped() const { return droppedTotal; }
+
+    private:
+        Ring ring;
+        Sink sink;
+        std::size_t droppedTotal = 0;
+        std::string line;
+        std::thread worker;
+        std::atomic<bool> bRunning = false;
+    };
+}
+
+// Log from a game thread without formatting or I/O on it. Arguments are stored raw, strings by pointer only.
+// First argument is the format string: ASYNC_LOG(Info, "Resolution: {:d}x{:d}", width, height)
+#define ASYNC_LOG(level, ...) \
+    do { \
+        static const std::uint16_t asyncLogFormat = AsyncLog::Formats::Register(AsyncLog::Level::level, AsyncLog::Detail::FormatText(__VA_ARGS__)); \
+        if (asyncLogFormat != AsyncLog::kNoFormat) \
+            AsyncLog::Logger::Global().Log(asyncLogFormat, __VA_ARGS__); \
+        else \
+            AsyncLog::Logger::Global().LogNow(AsyncLog::Level::level, __VA_ARGS__); \
+    } while (0)
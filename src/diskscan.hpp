@@ -0,0 +1,119 @@
+#pragma once
+
+#include "mappedfile.hpp"
+#include "pe.hpp"
+#include "scanner.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Signature scan of the executable on disk, run in the background while the loaded image is still unpacking.
+// Hits are kept as RVAs, so once the image is ready each one only needs Scanner::Matches() at the same RVA instead of a scan.
+// Platform-neutral, works on any mapped PE file (see tools/dafix-bench.cpp).
+namespace DiskScan
+{
+    struct Image
+    {
+        std::uint32_t timestamp = 0;
+        std::uint32_t sizeOfImage = 0;
+        std::size_t scanned = 0;    // Bytes of code section data scanned
+        double ms = 0.0;
+        std::unordered_map<std::string_view, std::uint32_t> rvas;   // By PatternView::text
+
+        std::optional<std::uint32_t> Find(const Scanner::PatternView& pattern) const
+        {
+            auto it = rvas.find(pattern.text);
+            if (it == rvas.end())
+                return std::nullopt;
+            return it->second;
+        }
+    };
+
+    // Every pattern over the code sections of a PE file held in [data, data + size), lowest file offset wins.
+    // nullopt if it isn't a PE file. Hits that don't map into the image (e.g. in a section's padding) are dropped.
+    inline std::optional<Image> Scan(const std::uint8_t* data, std::size_t size, std::span<const Scanner::PatternView> patterns, std::size_t threads = 1)
+    {
+        auto layout = PE::Parse(data, size);
+        if (!layout)
+            return std::nullopt;
+
+        Image image;
+        image.timestamp = layout->timestamp;
+        image.sizeOfImage = layout->sizeOfImage;
+
+        Scanner::Batch batch;
+        for (const auto& pattern : patterns)
+            batch.Add(pattern);
+        for (const auto& range : layout->FileRanges(PE::Region::Code, size)) {
+            batch.Run(data + range.offset, range.size, threads);
+            image.scanned += range.size;
+        }
+
+        for (const auto& pattern : patterns) {
+            const std::uint8_t* result = batch.Result(pattern);
+            if (!result)
+                continue;
+            if (auto rva = layout->OffsetToRva(static_cast<std::uint32_t>(result - data)))
+                image.rvas[pattern.text] = *rva;
+        }
+        return image;
+    }
+
+    // Maps and scans a file on a worker thread
+    class Prescan
+    {
+    public:
+        Prescan() = default;
+        ~Prescan() { Wait(); }
+
+        Prescan(const Prescan&) = delete;
+        Prescan& operator=(const Prescan&) = delete;
+
+        void Start(std::filesystem::path path, std::vector<Scanner::PatternView> patterns)
+        {
+            Wait();
+            result.reset();
+            bReady.store(false, std::memory_order_relaxed);
+            worker = std::thread([this, path = std::move(path), patterns = std::move(patterns)] {
+                auto start = std::chrono::steady_clock::now();
+                MappedFile file(path);
+                if (file)
+                    result = Scan(file.Data(), file.Size(), patterns);
+                if (result)
+                    result->ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                bReady.store(true, std::memory_order_release);
+            });
+        }
+
+        // Result if the scan has already finished, never blocks
+        const Image* Peek() const
+        {
+            if (!bReady.load(std::memory_order_acquire))
+                return nullptr;
+            return result ? &*result : nullptr;
+        }
+
+        // Blocks until the scan finishes. nullptr if it never started, the file couldn't be mapped or isn't a PE file.
+        const Image* Wait()
+        {
+            if (worker.joinable())
+                worker.join();
+            return result ? &*result : nullptr;
+        }
+
+    private:
+        std::thread worker;
+        std::atomic<bool> bReady = false;
+        std::optional<Image> result;
+    };
+}
@@ -1,5 +1,19 @@
 #include "stdafx.h"
 #include "helper.hpp"
+#include "asynclog.hpp"
+#include "diskscan.hpp"
+#include "features.hpp"
+#include "framepacer.hpp"
+#include "governor.hpp"
+#include "hooks.hpp"
+#include "hookset.hpp"
+#include "hookstats.hpp"
+#include "hooktrace.hpp"
+#include "pagewatch.hpp"
+#include "signatures.hpp"
+#include "stubs.hpp"
+#include "telemetry.hpp"
+#include "window.hpp"
 
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h>
@@ -20,6 +34,17 @@ std::filesystem::path sFixPath;
 inipp::Ini<char> ini;
 std::string sConfigFile = sFixName + ".ini";
 
+// Scan cache
+ScanCache::Cache scanCache;
+std::string sCacheFile = sFixName + ".cache";
+
+// Frame telemetry
+std::string sTelemetryFile = sFixName + "_frames.csv";
+Telemetry::Ring<std::int64_t, 8192> frameTimestamps;
+
+// Hook trace
+std::string sTraceFile = sFixName + "_trace.bin";
+
 // Logger
 std::shared_ptr<spdlog::logger> logger;
 std::string sLogFile = sFixName + ".log";
@@ -28,14 +53,35 @@ std::string sExeName;
 
 // Aspect ratio / FOV / HUD
 std::pair DesktopDimensions = { 0,0 };
-const float fPi = 3.1415926535f;
-const float fNativeAspect = 1.777777791f;
-float fAspectRatio;
-float fAspectMultiplier;
-float fHUDWidth;
-float fHUDWidthOffset;
-float fHUDHeight;
-float fHUDHeightOffset;
+
+// Borderless window, applied off the game thread at most every 50ms
+struct WindowApi
+{
+    Window::State Read(Window::Handle window)
+    {
+        auto hWnd = static_cast<HWND>(window);
+        Window::State state;
+        state.style = static_cast<std::uint32_t>(GetWindowLongW(hWnd, GWL_STYLE));
+        state.exStyle = static_cast<std::uint32_t>(GetWindowLongW(hWnd, GWL_EXSTYLE));
+        RECT rect = {};
+        GetWindowRect(hWnd, &rect);
+        state.rect = { rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top };
+        return state;
+    }
+
+    void SetStyle(Window::Handle window, std::uint32_t style) { SetWindowLongW(static_cast<HWND>(window), GWL_STYLE, static_cast<LONG>(style)); }
+    void SetExStyle(Window::Handle window, std::uint32_t exStyle) { SetWindowLongW(static_cast<HWND>(window), GWL_EXSTYLE, static_cast<LONG>(exStyle)); }
+
+    // The game's thread owns the window, so these calls send their messages (WM_STYLECHANGED, WM_NCCALCSIZE, ...) to its
+    // window procedure and the reconciler thread waits until the game handles them. SWP_ASYNCWINDOWPOS only posts the placement.
+    void Place(Window::Handle window, const Window::Rect& rect, bool bFrameChanged)
+    {
+        SetWindowPos(static_cast<HWND>(window), HWND_TOP, rect.x, rect.y, rect.width, rect.height,
+            SWP_NOACTIVATE | SWP_ASYNCWINDOWPOS | (bFrameChanged ? SWP_FRAMECHANGED : 0));
+    }
+} windowApi;
+Window::Reconciler<WindowApi> WindowReconciler(windowApi, std::chrono::milliseconds(50));
+Hooks::ResolutionState resolutionState;
 
 // Ini variables
 bool bBorderlessWindowed;
@@ -46,12 +92,28 @@ float fFoliageDrawDistance = 1.50f;
 float fObjectDrawDistance = 60.00f;
 float fNPCDrawDistance = 60.00f;
 int iShadowResolution = 1024;
+bool bDrawDistanceGovernor = false;
+float fGovernorTargetFrameTime = 16.70f;
+float fGovernorMinFoliage = 0.75f;
+float fGovernorMinNPC = 30.00f;
+float fGovernorMinObject = 30.00f;
+float fFrameLimit = 0.00f;
+bool bFrameTelemetry = false;
+int iTelemetryReportInterval = 10;
 
 // Variables
-int iCurrentResX;
-int iCurrentResY;
 int iOldResX;
 int iOldResY;
+std::uint8_t* FoliageDrawDistance = nullptr;
+std::uint8_t* NPCDrawDistance = nullptr;
+std::uint8_t* ObjectDrawDistance = nullptr;
+Governor::FrameTimer frameTimer;
+
+Scanner::Batch ScanBatch;
+DiskScan::Prescan DiskPrescan;
+std::map<std::string, std::uint32_t> SignatureHints;
+Memory::PatchTransaction Patches;
+HookSet& FixHooks = *new HookSet;  // Never destroyed, hooks may still jump into its code while the process exits
 
 enum class Game {
     DA1,
@@ -90,9 +152,19 @@ void Logging()
 
     // Spdlog initialisation
     try {
-        logger = spdlog::basic_logger_st(sFixName.c_str(), sExePath.string() + sLogFile, true);
+        logger = spdlog::basic_logger_mt(sFixName.c_str(), sExePath.string() + sLogFile, true);
         spdlog::set_default_logger(logger);
-        spdlog::flush_on(spdlog::level::debug);
+        spdlog::flush_on(spdlog::level::warn);
+
+        // Hooks log through AsyncLog, their lines are formatted and written here in batches.
+        // Each batch also flushes whatever the main thread logged since the last one.
+        AsyncLog::Logger::Global().Start({
+            [](AsyncLog::Level level, std::int64_t timestamp, std::string_view message) {
+                auto time = spdlog::log_clock::time_point(std::chrono::duration_cast<spdlog::log_clock::duration>(std::chrono::nanoseconds(timestamp)));
+                logger->log(time, spdlog::source_loc{}, static_cast<spdlog::level::level_enum>(level), message);
+            },
+            [] { logger->flush(); }
+        });
 
         spdlog::info("----------");
         spdlog::info("{:s} v{:s} loaded.", sFixName.c_str(), sFixVersion.c_str());
@@ -110,6 +182,8 @@ void Logging()
         FILE* dummy;
         freopen_s(&dummy, "CONOUT$", "w", stdout);
         std::cout << "Log initialisation failed: " << ex.what() << std::endl;
+        DiskPrescan.Wait();
+        AsyncLog::Logger::Global().Stop();
         FreeLibraryAndExitThread(thisModule, 1);
     }  
 }
@@ -125,6 +199,8 @@ void Configuration()
         std::cout << "" << sFixName.c_str() << " v" << sFixVersion.c_str() << " loaded." << std::endl;
         std::cout << "ERROR: Could not locate config file." << std::endl;
         std::cout << "ERROR: Make sure " << sConfigFile.c_str() << " is located in " << sFixPath.string().c_str() << std::endl;
+        DiskPrescan.Wait();
+        AsyncLog::Logger::Global().Stop();
         spdlog::shutdown();
         FreeLibraryAndExitThread(thisModule, 1);
     }
@@ -146,6 +222,24 @@ void Configuration()
     inipp::get_value(ini.sections["Draw Distances"], "NPC", fNPCDrawDistance);
     inipp::get_value(ini.sections["Draw Distances"], "Object", fObjectDrawDistance);
     inipp::get_value(ini.sections["Shadow Resolution"], "Resolution", iShadowResolution);
+    inipp::get_value(ini.sections["Draw Distance Governor"], "Enabled", bDrawDistanceGovernor);
+    inipp::get_value(ini.sections["Draw Distance Governor"], "TargetFrameTime", fGovernorTargetFrameTime);
+    inipp::get_value(ini.sections["Draw Distance Governor"], "MinFoliage", fGovernorMinFoliage);
+    inipp::get_value(ini.sections["Draw Distance Governor"], "MinNPC", fGovernorMinNPC);
+    inipp::get_value(ini.sections["Draw Distance Governor"], "MinObject", fGovernorMinObject);
+    inipp::get_value(ini.sections["Frame Limiter"], "FPS", fFrameLimit);
+    inipp::get_value(ini.sections["Frame Telemetry"], "Enabled", bFrameTelemetry);
+    inipp::get_value(ini.sections["Frame Telemetry"], "ReportInterval", iTelemetryReportInterval);
+
+    // Expected RVAs for signatures, e.g. "DA1_HUDScale = 0x1A2B3C", searched around before falling back to a full scan
+    for (const auto& [name, value] : ini.sections["Signature Hints"]) {
+        char* end = nullptr;
+        unsigned long rva = std::strtoul(value.c_str(), &end, 0);
+        if (end != value.c_str() && *end == '\0')
+            SignatureHints[name] = static_cast<std::uint32_t>(rva);
+        else
+            spdlog::warn("Config Parse: Signature Hints: Ignoring {} = {}", name, value);
+    }
 
     // Log ini parse
     spdlog_confparse(bBorderlessWindowed);
@@ -156,6 +250,16 @@ void Configuration()
     spdlog_confparse(fNPCDrawDistance);
     spdlog_confparse(fObjectDrawDistance);
     spdlog_confparse(iShadowResolution);
+    spdlog_confparse(bDrawDistanceGovernor);
+    spdlog_confparse(fGovernorTargetFrameTime);
+    spdlog_confparse(fGovernorMinFoliage);
+    spdlog_confparse(fGovernorMinNPC);
+    spdlog_confparse(fGovernorMinObject);
+    spdlog_confparse(fFrameLimit);
+    spdlog_confparse(bFrameTelemetry);
+    spdlog_confparse(iTelemetryReportInterval);
+    for (const auto& [name, rva] : SignatureHints)
+        spdlog::info("Config Parse: Signature Hint: {}: {:x}", name, rva);
 
     spdlog::info("----------");
 }
@@ -176,343 +280,790 @@ bool DetectGame()
     return false;
 }
 
+void StartDiskScan()
+{
+    // Every signature of this game over the exe on disk, in the background while GameInit() waits for the loaded image
+    unsigned gameMask = eGameType == Game::DA1 ? Signatures::kDA1 : eGameType == Game::DA2 ? Signatures::kDA2 : 0;
+    std::vector<Scanner::PatternView> patterns;
+    for (const auto& entry : Signatures::kAll) {
+        if (entry.games & gameMask)
+            patterns.push_back(entry.pattern);
+    }
+    DiskPrescan.Start(sExePath / sExeName, std::move(patterns));
+}
+
 void GameInit()
 {
-    // Wait up to 30s for the game to initialise
+    // Wait up to 30s for the game to unpack and initialise, polling every 200ms. Attempts only rescan code pages whose sampled
+    // lines changed since the previous one, and every kFullRescanEvery-th scans everything in case a change missed the samples.
+    // The code's byte profile barely changes between attempts, so the signature is anchored on its rarest bytes once.
+    // Once the disk scan has found the signature, checking its RVA comes first.
+    Scanner::PatternView gameInit = Scanner::Anchor(Signatures::GameInit, Memory::ModuleProfile(exeModule));
+    std::map<std::uint8_t*, PageWatch::Tracker> trackers;
     std::uint8_t* GameInitScanResult = nullptr;
-    for (int attempt = 1; attempt <= 150; ++attempt) {
-        GameInitScanResult = Memory::PatternScan(exeModule, "D9 ?? ?? ?? D9 ?? ?? ?? ?? ?? 32 ?? 5E 8B ?? 5D C2 ?? ??");
-        if (GameInitScanResult) {
-            spdlog::info("Game initialisation complete.");
-            spdlog::info("----------");
-            break;
+    int attempt = 1;
+    std::size_t rescanned = 0;
+    for (; attempt <= 150; ++attempt) {
+        const DiskScan::Image* disk = DiskPrescan.Peek();
+        if (auto rva = disk ? disk->Find(Signatures::GameInit) : std::nullopt) {
+            auto candidate = reinterpret_cast<std::uint8_t*>(exeModule) + *rva;
+            if (Memory::IsReadable(candidate, Signatures::GameInit.size()) && Scanner::Matches(candidate, Signatures::GameInit)) {
+                GameInitScanResult = candidate;
+                break;
+            }
+        }
+
+        bool bFull = PageWatch::FullRescan(attempt);
+        for (const auto& [scanBytes, size] : Memory::ScanRanges(exeModule, PE::Region::Code)) {
+            auto changed = trackers[scanBytes].Update(scanBytes, size);
+            const std::uint8_t* result = nullptr;
+            if (bFull) {
+                rescanned += size;
+                result = Scanner::FindParallel(scanBytes, size, gameInit);
+            }
+            else {
+                for (const auto& span : changed)
+                    rescanned += span.size;
+                result = PageWatch::Rescan(scanBytes, size, changed, gameInit);
+            }
+            if (result) {
+                GameInitScanResult = const_cast<std::uint8_t*>(result);
+                break;
+            }
         }
+        if (GameInitScanResult)
+            break;
         std::this_thread::sleep_for(std::chrono::milliseconds(200));
     }
-    if (!GameInitScanResult) {
+
+    if (GameInitScanResult) {
+        ScanBatch.Seed(Signatures::GameInit, GameInitScanResult);
+        spdlog::info("Game initialisation complete ({:d} attempts, {:d} KB rescanned).", attempt, rescanned / 1024);
+        spdlog::info("----------");
+    }
+    else {
         spdlog::error("Failed to detect game initialisation.");
+        DiskPrescan.Wait();
+        AsyncLog::Logger::Global().Stop();
         spdlog::shutdown();
         FreeLibraryAndExitThread(thisModule, 1);
     }
 }
 
-void CalculateAspectRatio(bool bLog)
+void ScanSignatures(unsigned gameMask, const std::vector<std::string_view>& features)
 {
-    if (iCurrentResX <= 0 || iCurrentResY <= 0)
-        return;
+    // Register every signature the enabled features use, then resolve them all together
+    std::vector<const Signatures::Entry*> signatures;
+    for (const auto& entry : Signatures::kAll) {
+        if ((entry.games & gameMask) && std::find(features.begin(), features.end(), entry.feature) != features.end())
+            signatures.push_back(&entry);
+    }
+    for (const auto* signature : signatures)
+        ScanBatch.Add(signature->pattern);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Warm start: verify addresses cached by a previous launch of the same build in place, only scan for the rest.
+    // The key is taken before any patches are applied, so it matches what the previous launch saw.
+    auto exeBase = reinterpret_cast<std::uint8_t*>(exeModule);
+    ScanCache::Key cacheKey = { Memory::ModuleTimestamp(exeModule), Memory::CodeHash(exeModule) };
+    bool bCacheValid = scanCache.Load(sFixPath / sCacheFile, cacheKey);
+
+    std::size_t cachedCount = 0;
+    std::map<const Signatures::Entry*, std::uint32_t> hints;
+    for (const auto* signature : signatures) {
+        std::uint32_t rva = 0;
+        if (bCacheValid && scanCache.Find(signature->pattern.text, rva) && Memory::IsReadable(exeBase + rva, signature->pattern.size()) && Scanner::Matches(exeBase + rva, signature->pattern)) {
+            ScanBatch.Seed(signature->pattern, exeBase + rva);
+            ++cachedCount;
+            continue;
+        }
+
+        // A stale cache entry is where the signature was in the previous build, the config can override it
+        if (!bCacheValid && scanCache.Find(signature->pattern.text, rva))
+            hints[signature] = rva;
+        if (auto hint = SignatureHints.find(signature->name); hint != SignatureHints.end())
+            hints[signature] = hint->second;
+    }
+    if (!bCacheValid)
+        scanCache.Clear();
+
+    // Disk scan: hits are checked in place at the same RVA, one that no longer matches is still a good hint.
+    // Usually finished long before the game initialised, a warm start with every signature cached doesn't wait for it at all.
+    std::size_t diskCount = 0;
+    const DiskScan::Image* disk = ScanBatch.Resolved() < ScanBatch.Count() ? DiskPrescan.Wait() : nullptr;
+    if (disk) {
+        spdlog::info("Signature Scan: Disk scan found {:d} signatures in {:d} KB of {:s} in {:.2f}ms.", disk->rvas.size(), disk->scanned / 1024, sExeName, disk->ms);
+        for (const auto* signature : signatures) {
+            auto rva = ScanBatch.Result(signature->pattern) ? std::nullopt : disk->Find(signature->pattern);
+            if (!rva)
+                continue;
+            if (Memory::IsReadable(exeBase + *rva, signature->pattern.size()) && Scanner::Matches(exeBase + *rva, signature->pattern)) {
+                ScanBatch.Seed(signature->pattern, exeBase + *rva);
+                hints.erase(signature);
+                ++diskCount;
+            }
+            else {
+                hints.try_emplace(signature, *rva);
+            }
+        }
+    }
+    else if (ScanBatch.Resolved() < ScanBatch.Count()) {
+        spdlog::warn("Signature Scan: Disk scan of {:s} failed.", sExeName);
+    }
+
+    // Hinted: search outward from the expected address, only what's still missing goes to the full scan
+    std::size_t hintedCount = 0;
+    if (!hints.empty()) {
+        auto codeRanges = Memory::ScanRanges(exeModule, PE::Region::Code);
+        for (const auto& [signature, rva] : hints) {
+            if (std::uint8_t* result = Memory::NearPatternScan(codeRanges, signature->pattern, exeBase + rva)) {
+                ScanBatch.Seed(signature->pattern, result);
+                ++hintedCount;
+                std::ptrdiff_t drift = (result - exeBase) - static_cast<std::ptrdiff_t>(rva);
+                if (drift)
+                    spdlog::warn("Signature Scan: {:s} drifted {:d} bytes from its hint ({:x} -> {:x}).", signature->name, drift, rva, result - exeBase);
+            }
+            else {
+                spdlog::warn("Signature Scan: {:s} not found near its hint ({:x}).", signature->name, rva);
+            }
+        }
+    }
 
-    // Calculate aspect ratio
-    fAspectRatio = (float)iCurrentResX / (float)iCurrentResY;
-    fAspectMultiplier = fAspectRatio / fNativeAspect;
+    if (ScanBatch.Resolved() < ScanBatch.Count())
+        Memory::BatchPatternScan(exeModule, ScanBatch);
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("Signature Scan: Resolved {:d}/{:d} signatures ({:d} from cache, {:d} from disk, {:d} near hints) in {:.2f}ms.", ScanBatch.Resolved(), ScanBatch.Count(),
+        cachedCount, diskCount, hintedCount, elapsed);
 
-    // HUD 
-    fHUDWidth = (float)iCurrentResY * fNativeAspect;
-    fHUDHeight = (float)iCurrentResY;
-    fHUDWidthOffset = (float)(iCurrentResX - fHUDWidth) / 2.00f;
-    fHUDHeightOffset = 0.00f;
-    if (fAspectRatio < fNativeAspect) {
-        fHUDWidth = (float)iCurrentResX;
-        fHUDHeight = (float)iCurrentResX / fNativeAspect;
-        fHUDWidthOffset = 0.00f;
-        fHUDHeightOffset = (float)(iCurrentResY - fHUDHeight) / 2.00f;
+    // Write back anything new
+    bool bCacheChanged = !bCacheValid;
+    for (const auto* signature : signatures) {
+        if (const std::uint8_t* result = ScanBatch.Result(signature->pattern))
+            bCacheChanged |= scanCache.Store(signature->pattern.text, static_cast<std::uint32_t>(result - exeBase));
     }
+    if (bCacheChanged && !scanCache.Save(sFixPath / sCacheFile, cacheKey))
+        spdlog::warn("Signature Scan: Failed to write {}", (sFixPath / sCacheFile).string());
+    spdlog::info("----------");
+}
+
+void CalculateAspectRatio(int iResX, int iResY, bool bLog)
+{
+    if (iResX <= 0 || iResY <= 0)
+        return;
+
+    // Publish a new snapshot with the callbacks specialized for it, hooks pick both up on their next call
+    Hooks::Resolution calculated = Hooks::CalculateResolution(iResX, iResY, fHUDScale);
+    calculated.callbacks = Hooks::Select<SafetyHookContext>(eGameType == Game::DA2 ? Hooks::Variant::DA2 : Hooks::Variant::DA1, calculated);
+    const Hooks::Resolution& resolution = resolutionState.Publish(calculated);
+    HOOK_TRACE_RESOLUTION(iResX, iResY);
 
     // Log details about current resolution
     if (bLog) {
-        spdlog::info("----------");
-        spdlog::info("Current Resolution: Resolution: {:d}x{:d}", iCurrentResX, iCurrentResY);
-        spdlog::info("Current Resolution: fAspectRatio: {}", fAspectRatio);
-        spdlog::info("Current Resolution: fAspectMultiplier: {}", fAspectMultiplier);
-        spdlog::info("Current Resolution: fHUDWidth: {}", fHUDWidth);
-        spdlog::info("Current Resolution: fHUDHeight: {}", fHUDHeight);
-        spdlog::info("Current Resolution: fHUDWidthOffset: {}", fHUDWidthOffset);
-        spdlog::info("Current Resolution: fHUDHeightOffset: {}", fHUDHeightOffset);
-        spdlog::info("----------");
+        ASYNC_LOG(Info, "----------");
+        ASYNC_LOG(Info, "Current Resolution: Resolution: {:d}x{:d}", resolution.width, resolution.height);
+        ASYNC_LOG(Info, "Current Resolution: Aspect Ratio: {}", resolution.aspectRatio);
+        ASYNC_LOG(Info, "Current Resolution: Aspect Multiplier: {}", resolution.aspectMultiplier);
+        ASYNC_LOG(Info, "Current Resolution: HUD Width: {}", resolution.hudWidth);
+        ASYNC_LOG(Info, "Current Resolution: HUD Height: {}", resolution.hudHeight);
+        ASYNC_LOG(Info, "Current Resolution: HUD Width Offset: {}", resolution.hudWidthOffset);
+        ASYNC_LOG(Info, "Current Resolution: HUD Height Offset: {}", resolution.hudHeightOffset);
+        ASYNC_LOG(Info, "Current Resolution: HUD Scale: {}", resolution.hudScale);
+        ASYNC_LOG(Info, "----------");
     }
 }
 
-void CurrentResolution()
+// Hooks are installed into FixHooks when the patch transaction commits, see ApplyPatches()
+void QueueMidHook(SafetyHookMid& hook, std::uint8_t* address, safetyhook::MidHookFn destination)
 {
-    // Grab desktop resolution/aspect just in case
-    DesktopDimensions = Util::GetPhysicalDesktopDimensions();
-    iCurrentResX = DesktopDimensions.first;
-    iCurrentResY = DesktopDimensions.second;
-    CalculateAspectRatio(false);
-
-    if (eGameType == Game::DA1 || eGameType == Game::DA2) {
-        // DA1/DA2: Current Resolution
-        std::uint8_t* CurrentResolutionScanResult = Memory::MultiPatternScan(exeModule, { "D9 ?? ?? ?? ?? ?? 85 ?? DB ?? ?? ?? ?? ?? ?? 7D ?? D8 ?? ?? ?? ?? ??", "DB ?? ?? ?? ?? ?? ?? 85 ?? 7D ?? D8 ?? ?? ?? ?? ?? 8B ?? ?? ?? ?? ?? ?? D9 ?? ?? ?? ?? ?? D9 ??" });
-        if (CurrentResolutionScanResult) {
-            spdlog::info("DA1/DA2: Current Resolution: Address is {:s}+{:x}", sExeName.c_str(), CurrentResolutionScanResult - (std::uint8_t*)exeModule);
-            static SafetyHookMid CurrentResolutionMidHook{};
-            CurrentResolutionMidHook = safetyhook::create_mid(CurrentResolutionScanResult,
-                [](SafetyHookContext& ctx) {
-                    int iResX = ctx.eax;
-                    int iResY = ctx.ecx;
-                    if (iResX != iCurrentResX || iResY != iCurrentResY) {
-                        iCurrentResX = iResX;
-                        iCurrentResY = iResY;
-                        CalculateAspectRatio(true);
-                    }
-                });
-        }
-        else {
-            spdlog::error("DA1/DA2: Current Resolution: Pattern scan failed.");
-        }
+    Patches.Step(
+        [&hook, address, destination] { return FixHooks.Mid(hook, address, destination); },
+        [&hook] { hook = {}; });
+}
+
+// Hooks that only store resolution values can get a generated stub instead of a mid hook (see stubs.hpp).
+// Stubs are opt-in with DAFIX_STUB_HOOKS until dafix-stubs has been run against them, every other build uses the mid hook.
+// Hook stats and trace builds always use it so every hook is timed and traced, and it is the fallback if the stub can't be built.
+void QueueStubHook(const char* name, Stubs::Hook& stub, SafetyHookMid& hook, std::uint8_t* address, std::span<const Stubs::Store> stores, safetyhook::MidHookFn fallback)
+{
+    Patches.Step(
+        [name, &stub, &hook, address, stores, fallback] {
+#if defined(DAFIX_STUB_HOOKS) && !defined(DAFIX_HOOK_STATS) && !defined(DAFIX_HOOK_TRACE)
+            if (FixHooks.Stub(name, stub, address, stores, resolutionState.Address()))
+                return true;
+            spdlog::warn("Stub hook at {:s}+{:x} unavailable, using a mid hook.", sExeName.c_str(), address - (std::uint8_t*)exeModule);
+#endif
+            return FixHooks.Mid(hook, address, fallback);
+        },
+        [&stub, &hook] {
+            stub.Reset();
+            hook = {};
+        });
+}
+
+bool CurrentResolution()
+{
+    // DA1/DA2: Current Resolution
+    std::uint8_t* CurrentResolutionScanResult = Memory::BatchResult(ScanBatch, Signatures::CurrentResolution);
+    if (CurrentResolutionScanResult) {
+        spdlog::info("DA1/DA2: Current Resolution: Address is {:s}+{:x}", sExeName.c_str(), CurrentResolutionScanResult - (std::uint8_t*)exeModule);
+        static SafetyHookMid CurrentResolutionMidHook{};
+        QueueMidHook(CurrentResolutionMidHook, CurrentResolutionScanResult,
+            [](SafetyHookContext& ctx) {
+                HOOK_STATS_SCOPE("CurrentResolution");
+                HOOK_TRACE_SCOPE(CurrentResolution, ctx);
+                int iResX = ctx.eax;
+                int iResY = ctx.ecx;
+                if (Hooks::ResolutionChanged(ctx, resolutionState.Load()))
+                    CalculateAspectRatio(iResX, iResY, true);
+            });
+        return true;
+    }
+    else {
+        spdlog::error("DA1/DA2: Current Resolution: Pattern scan failed.");
+        return false;
     }
 }
 
-void WindowManagement()
-{
-    if (eGameType == Game::DA1 && bBorderlessWindowed) {
-        // DA1: Borderless Windowed
-        std::uint8_t* DA1_BorderlessScanResult = Memory::PatternScan(exeModule, "74 ?? 8B ?? ?? ?? ?? ?? ?? ?? 50 FF ?? ?? ?? ?? ?? 5E C3");
-        if (DA1_BorderlessScanResult) {
-            spdlog::info("DA1: Borderless: Address is {:s}+{:x}", sExeName.c_str(), DA1_BorderlessScanResult - (std::uint8_t*)exeModule);
-            static SafetyHookMid DA1_BorderlessMidHook{};
-            DA1_BorderlessMidHook = safetyhook::create_mid(DA1_BorderlessScanResult,
-                [](SafetyHookContext& ctx) {
-                    if (ctx.esi) {
-                        // Check if windowed mode
-                        if (*reinterpret_cast<int*>(ctx.esi + 0x130) == 1) {
-                            // Get HWND
-                            HWND hWnd = *reinterpret_cast<HWND*>(ctx.esi + 0x168);
-
-                            // Get styles
-                            LONG lStyle = GetWindowLongW(hWnd, GWL_STYLE);
-                            LONG lExStyle = GetWindowLongW(hWnd, GWL_EXSTYLE);
-
-                            // Apply borderless style
-                            lStyle &= ~(WS_CAPTION | WS_THICKFRAME | WS_MINIMIZE | WS_MAXIMIZE | WS_SYSMENU);
-                            lExStyle &= ~(WS_EX_DLGMODALFRAME | WS_EX_CLIENTEDGE | WS_EX_STATICEDGE);
-                            SetWindowLongW(hWnd, GWL_STYLE, lStyle);
-                            SetWindowLongW(hWnd, GWL_EXSTYLE, lExStyle);
-
-                            // Set window on top
-                            SetWindowPos(hWnd, HWND_TOP, 0, 0, DesktopDimensions.first, DesktopDimensions.second, SWP_FRAMECHANGED | SWP_NOACTIVATE);
-                            spdlog::info("DA1: Borderless: Applied borderless style.");
-                        }
+// Borderless hooks only queue requests, this thread makes the window calls
+void StartWindowReconciler()
+{
+    static std::once_flag started;
+    std::call_once(started, [] {
+        std::thread([] {
+            WindowReconciler.Run();
+        }).detach();
+        spdlog::info("Borderless: Window reconciler started.");
+    });
+}
+
+bool DA1_Borderless()
+{
+    // DA1: Borderless Windowed
+    std::uint8_t* DA1_BorderlessScanResult = Memory::BatchResult(ScanBatch, Signatures::DA1_Borderless);
+    if (DA1_BorderlessScanResult) {
+        spdlog::info("DA1: Borderless: Address is {:s}+{:x}", sExeName.c_str(), DA1_BorderlessScanResult - (std::uint8_t*)exeModule);
+        StartWindowReconciler();
+        static SafetyHookMid DA1_BorderlessMidHook{};
+        QueueMidHook(DA1_BorderlessMidHook, DA1_BorderlessScanResult,
+            [](SafetyHookContext& ctx) {
+                HOOK_STATS_SCOPE("DA1_Borderless");
+                if (ctx.esi) {
+                    // Check if windowed mode
+                    if (*reinterpret_cast<int*>(ctx.esi + 0x130) == 1) {
+                        // Get HWND
+                        HWND hWnd = *reinterpret_cast<HWND*>(ctx.esi + 0x168);
+
+                        // Borderless and covering the desktop, applied by the reconciler thread
+                        WindowReconciler.Request(hWnd, { 0, 0, DesktopDimensions.first, DesktopDimensions.second });
                     }
-                });
-        }
-        else {
-            spdlog::error("DA1: Borderless: Pattern scan failed.");
-        }
+                }
+            });
+        return true;
+    }
+    else {
+        spdlog::error("DA1: Borderless: Pattern scan failed.");
+        return false;
     }
+}
+
+bool DA2_Borderless()
+{
+    // DA2: Borderless Windowed
+    std::uint8_t* DA2_BorderlessScanResult = Memory::BatchResult(ScanBatch, Signatures::DA2_Borderless);
+    if (DA2_BorderlessScanResult) {
+        spdlog::info("DA2: Borderless: Address is {:s}+{:x}", sExeName.c_str(), DA2_BorderlessScanResult - (std::uint8_t*)exeModule);
+        StartWindowReconciler();
+        static SafetyHookMid DA2_BorderlessMidHook{};
+        QueueMidHook(DA2_BorderlessMidHook, DA2_BorderlessScanResult,
+            [](SafetyHookContext& ctx) {
+                HOOK_STATS_SCOPE("DA2_Borderless");
+                if (ctx.esi) {
+                    // Check if windowed mode
+                    if (*reinterpret_cast<BYTE*>(ctx.esi + 0x69) == 0) {
+                        // Get HWND
+                        HWND hWnd = *reinterpret_cast<HWND*>(ctx.esi + 0x48);
 
-    if (eGameType == Game::DA2 && bBorderlessWindowed) {
-        // DA2: Borderless Windowed
-        std::uint8_t* DA2_BorderlessScanResult = Memory::PatternScan(exeModule, "8B ?? ?? 52 FF ?? 8B ?? ?? ?? ?? ?? 8B ?? 8A ??");
-        if (DA2_BorderlessScanResult) {
-            spdlog::info("DA2: Borderless: Address is {:s}+{:x}", sExeName.c_str(), DA2_BorderlessScanResult - (std::uint8_t*)exeModule);
-            static SafetyHookMid DA2_BorderlessMidHook{};
-            DA2_BorderlessMidHook = safetyhook::create_mid(DA2_BorderlessScanResult,
-                [](SafetyHookContext& ctx) {
-                    if (ctx.esi) {
-                        // Check if windowed mode
-                        if (*reinterpret_cast<BYTE*>(ctx.esi + 0x69) == 0) {
-                            // Get HWND
-                            HWND hWnd = *reinterpret_cast<HWND*>(ctx.esi + 0x48);
-
-                            // Get styles
-                            LONG lStyle = GetWindowLongW(hWnd, GWL_STYLE);
-                            LONG lExStyle = GetWindowLongW(hWnd, GWL_EXSTYLE);
-
-                            // Apply borderless style
-                            lStyle &= ~(WS_CAPTION | WS_THICKFRAME | WS_MINIMIZE | WS_MAXIMIZE | WS_SYSMENU);
-                            lExStyle &= ~(WS_EX_DLGMODALFRAME | WS_EX_CLIENTEDGE | WS_EX_STATICEDGE);
-                            SetWindowLongW(hWnd, GWL_STYLE, lStyle);
-                            SetWindowLongW(hWnd, GWL_EXSTYLE, lExStyle);
-
-                            // Set window on top
-                            SetWindowPos(hWnd, HWND_TOP, 0, 0, DesktopDimensions.first, DesktopDimensions.second, SWP_FRAMECHANGED | SWP_NOACTIVATE);
-                            spdlog::info("DA2: Borderless: Applied borderless style.");
-                        }
+                        // Borderless and covering the desktop, applied by the reconciler thread
+                        WindowReconciler.Request(hWnd, { 0, 0, DesktopDimensions.first, DesktopDimensions.second });
                     }
-                });
-        }
-        else {
-            spdlog::error("DA2: Borderless: Pattern scan failed.");
-        }
+                }
+            });
+        return true;
+    }
+    else {
+        spdlog::error("DA2: Borderless: Pattern scan failed.");
+        return false;
     }
 }
 
-void AspectRatio()
-{   
-    if (eGameType == Game::DA1 && bFixAspect) {
-        // DA1: Speedtree Culling
-        std::uint8_t* DA1_SpeedtreeCullingScanResult = Memory::PatternScan(exeModule, "F6 ?? 05 7B ?? D9 ?? ?? ?? ?? ?? DE ?? D9 ?? ?? ?? ?? ??");
-        if (DA1_SpeedtreeCullingScanResult) {
-            spdlog::info("DA1: Aspect Ratio: Speedtree Culling: Address is {:s}+{:x}", sExeName.c_str(), DA1_SpeedtreeCullingScanResult - (std::uint8_t*)exeModule);
-            Memory::PatchBytes(DA1_SpeedtreeCullingScanResult + 0x2, "\x00", 1);
-            spdlog::info("DA1: Aspect Ratio: Speedtree Culling: Patched instruction.");
-        }
-        else {
-            spdlog::error("DA1: Aspect Ratio: Speedtree Culling: Pattern scan failed.");
-        }
+bool DA1_SpeedtreeCulling()
+{
+    // DA1: Speedtree Culling
+    std::uint8_t* DA1_SpeedtreeCullingScanResult = Memory::BatchResult(ScanBatch, Signatures::DA1_SpeedtreeCulling);
+    if (DA1_SpeedtreeCullingScanResult) {
+        spdlog::info("DA1: Aspect Ratio: Speedtree Culling: Address is {:s}+{:x}", sExeName.c_str(), DA1_SpeedtreeCullingScanResult - (std::uint8_t*)exeModule);
+        Patches.Bytes(DA1_SpeedtreeCullingScanResult + 0x2, "\x00", 1);
+        spdlog::info("DA1: Aspect Ratio: Speedtree Culling: Queued patch.");
+        return true;
+    }
+    else {
+        spdlog::error("DA1: Aspect Ratio: Speedtree Culling: Pattern scan failed.");
+        return false;
+    }
+}
 
-        // DA1: Shadow Aspect Ratio
-        std::uint8_t* DA1_ShadowAspectRatioScanResult = Memory::PatternScan(exeModule, "8B ?? 8B ?? ?? ?? ?? ?? 8B ?? FF ?? DC ?? ?? ?? ?? ?? D9 ?? ?? ?? D9 ?? ?? ?? E8 ?? ?? ?? ??");
-        if (DA1_ShadowAspectRatioScanResult) {
-            spdlog::info("DA1: Aspect Ratio: Shadows: Address is {:s}+{:x}", sExeName.c_str(), DA1_ShadowAspectRatioScanResult - (std::uint8_t*)exeModule);
-            static SafetyHookMid DA1_ShadowAspectRatioMidHook{};
-            DA1_ShadowAspectRatioMidHook = safetyhook::create_mid(DA1_ShadowAspectRatioScanResult,
-                [](SafetyHookContext& ctx) {
-                    if (fAspectRatio > fNativeAspect && ctx.esp)
-                        *reinterpret_cast<float*>(ctx.esp + 0xC) = fNativeAspect;
-                });
-        }
-        else {
-            spdlog::error("DA1: Aspect Ratio: Shadows: Pattern scan failed.");
-        }    
-    }
-    
-    if (eGameType == Game::DA1 && bDisablePillarboxing) {
-        // DA1: Dialog Pillarboxing
-        std::uint8_t* DA1_PillarboxingScanResult = Memory::PatternScan(exeModule, "FF ?? 8B ?? ?? ?? ?? ?? 85 C0 74 ?? C6 ?? ?? 01");
-        if (DA1_PillarboxingScanResult) {
-            spdlog::info("DA1: Aspect Ratio: Dialog Pillarboxing: Address is {:s}+{:x}", sExeName.c_str(), DA1_PillarboxingScanResult - (std::uint8_t*)exeModule);
-            static SafetyHookMid DA1_PillarboxingMidHook{};
-            DA1_PillarboxingMidHook = safetyhook::create_mid(DA1_PillarboxingScanResult,
-                [](SafetyHookContext& ctx) {
-                    if (ctx.esp) {
-                        *reinterpret_cast<int*>(ctx.esp + 0x0) = 0;             // Left
-                        *reinterpret_cast<int*>(ctx.esp + 0x4) = 0;             // Right
-                        *reinterpret_cast<int*>(ctx.esp + 0x8) = iCurrentResX;  // Width
-                        *reinterpret_cast<int*>(ctx.esp + 0xC) = iCurrentResY;  // Height
-                    }
-                });
-        }
-        else {
-            spdlog::error("DA1: Aspect Ratio: Dialog Pillarboxing: Pattern scan failed.");
-        }
+bool DA1_ShadowAspectRatio()
+{
+    // DA1: Shadow Aspect Ratio
+    std::uint8_t* DA1_ShadowAspectRatioScanResult = Memory::BatchResult(ScanBatch, Signatures::DA1_ShadowAspectRatio);
+    if (DA1_ShadowAspectRatioScanResult) {
+        spdlog::info("DA1: Aspect Ratio: Shadows: Address is {:s}+{:x}", sExeName.c_str(), DA1_ShadowAspectRatioScanResult - (std::uint8_t*)exeModule);
+        static SafetyHookMid DA1_ShadowAspectRatioMidHook{};
+        QueueMidHook(DA1_ShadowAspectRatioMidHook, DA1_ShadowAspectRatioScanResult,
+            [](SafetyHookContext& ctx) {
+                HOOK_STATS_SCOPE("DA1_ShadowAspectRatio");
+                HOOK_TRACE_SCOPE(DA1_ShadowAspectRatio, ctx);
+                Hooks::Call(&Hooks::Callbacks::shadowAspectRatio, ctx, resolutionState.Load());
+            });
+        return true;
     }
-    else if (eGameType == Game::DA2 && bDisablePillarboxing) {
-        // DA2: Dialog Pillarboxing
-        std::uint8_t* DA2_PillarboxingScanResult = Memory::PatternScan(exeModule, "89 ?? ?? ?? 89 ?? ?? ?? EB ?? DD ?? DE ?? DF ?? F6 ?? ?? 7A ??");
-        if (DA2_PillarboxingScanResult) {
-            spdlog::info("DA2: Aspect Ratio: Dialog Pillarboxing: Address is {:s}+{:x}", sExeName.c_str(), DA2_PillarboxingScanResult - (std::uint8_t*)exeModule);
-            static SafetyHookMid DA2_PillarboxingMidHook{};
-            DA2_PillarboxingMidHook = safetyhook::create_mid(DA2_PillarboxingScanResult,
-                [](SafetyHookContext& ctx) {
-                    ctx.ebx = 0;            // Left
-                    ctx.ebp = 0;            // Right
-                    ctx.ecx = iCurrentResX; // Width
-                    ctx.edx = iCurrentResY; // Height
-                });
-        }
-        else {
-            spdlog::error("DA2: Aspect Ratio: Dialog Pillarboxing: Pattern scan failed.");
-        }
-    }   
-}
-
-void FOV()
-{
-    if ((eGameType == Game::DA1 || eGameType == Game::DA2) && bDisablePillarboxing) {
-        // DA1/DA2: Dialog FOV
-        std::uint8_t* DA1_DA2_DialogFOVScanResult = Memory::PatternScan(exeModule, "D9 ?? ?? ?? D9 ?? ?? ?? ?? ?? 32 ?? 5E 8B ?? 5D C2 ?? ??");
-        if (DA1_DA2_DialogFOVScanResult) {
-            spdlog::info("DA1/DA2: FOV: Dialog: Address is {:s}+{:x}", sExeName.c_str(), DA1_DA2_DialogFOVScanResult - (std::uint8_t*)exeModule);
-            static SafetyHookMid DA1_DA2_DialogFOVMidHook{};
-            DA1_DA2_DialogFOVMidHook = safetyhook::create_mid(DA1_DA2_DialogFOVScanResult,
-                [](SafetyHookContext& ctx) {
-                    if (fAspectRatio > fNativeAspect && ctx.esp)
-                        *reinterpret_cast<float*>(ctx.esp + 0xC) = atanf(tanf(*reinterpret_cast<float*>(ctx.esp + 0xC) * (fPi / 360)) / fNativeAspect * fAspectRatio) * (360 / fPi);
-                });
+    else {
+        spdlog::error("DA1: Aspect Ratio: Shadows: Pattern scan failed.");
+        return false;
+    }
+}
+
+bool DA1_Pillarboxing()
+{
+    // DA1: Dialog Pillarboxing
+    std::uint8_t* DA1_PillarboxingScanResult = Memory::BatchResult(ScanBatch, Signatures::DA1_Pillarboxing);
+    if (DA1_PillarboxingScanResult) {
+        spdlog::info("DA1: Aspect Ratio: Dialog Pillarboxing: Address is {:s}+{:x}", sExeName.c_str(), DA1_PillarboxingScanResult - (std::uint8_t*)exeModule);
+        static Stubs::Hook DA1_PillarboxingStub{};
+        static SafetyHookMid DA1_PillarboxingMidHook{};
+        QueueStubHook("DA1_Pillarboxing", DA1_PillarboxingStub, DA1_PillarboxingMidHook, DA1_PillarboxingScanResult, Stubs::kDA1_Pillarboxing,
+            [](SafetyHookContext& ctx) {
+                HOOK_STATS_SCOPE("DA1_Pillarboxing");
+                HOOK_TRACE_SCOPE(DA1_Pillarboxing, ctx);
+                Hooks::Call(&Hooks::Callbacks::pillarboxing, ctx, resolutionState.Load());
+            });
+        return true;
+    }
+    else {
+        spdlog::error("DA1: Aspect Ratio: Dialog Pillarboxing: Pattern scan failed.");
+        return false;
+    }
+}
+
+bool DA2_Pillarboxing()
+{
+    // DA2: Dialog Pillarboxing
+    std::uint8_t* DA2_PillarboxingScanResult = Memory::BatchResult(ScanBatch, Signatures::DA2_Pillarboxing);
+    if (DA2_PillarboxingScanResult) {
+        spdlog::info("DA2: Aspect Ratio: Dialog Pillarboxing: Address is {:s}+{:x}", sExeName.c_str(), DA2_PillarboxingScanResult - (std::uint8_t*)exeModule);
+        static Stubs::Hook DA2_PillarboxingStub{};
+        static SafetyHookMid DA2_PillarboxingMidHook{};
+        QueueStubHook("DA2_Pillarboxing", DA2_PillarboxingStub, DA2_PillarboxingMidHook, DA2_PillarboxingScanResult, Stubs::kDA2_Pillarboxing,
+            [](SafetyHookContext& ctx) {
+                HOOK_STATS_SCOPE("DA2_Pillarboxing");
+                HOOK_TRACE_SCOPE(DA2_Pillarboxing, ctx);
+                Hooks::Call(&Hooks::Callbacks::pillarboxing, ctx, resolutionState.Load());
+            });
+        return true;
+    }
+    else {
+        spdlog::error("DA2: Aspect Ratio: Dialog Pillarboxing: Pattern scan failed.");
+        return false;
+    }
+}
+
+bool DialogFOV()
+{
+    // DA1/DA2: Dialog FOV
+    std::uint8_t* DA1_DA2_DialogFOVScanResult = Memory::BatchResult(ScanBatch, Signatures::DA1_DA2_DialogFOV);
+    if (DA1_DA2_DialogFOVScanResult) {
+        spdlog::info("DA1/DA2: FOV: Dialog: Address is {:s}+{:x}", sExeName.c_str(), DA1_DA2_DialogFOVScanResult - (std::uint8_t*)exeModule);
+        static SafetyHookMid DA1_DA2_DialogFOVMidHook{};
+        QueueMidHook(DA1_DA2_DialogFOVMidHook, DA1_DA2_DialogFOVScanResult,
+            [](SafetyHookContext& ctx) {
+                HOOK_STATS_SCOPE("DA1_DA2_DialogFOV");
+                HOOK_TRACE_SCOPE(DialogFOV, ctx);
+                Hooks::Call(&Hooks::Callbacks::dialogFOV, ctx, resolutionState.Load());
+            });
+        return true;
+    }
+    else {
+        spdlog::error("DA1/DA2: FOV: Dialog: Pattern scan failed.");
+        return false;
+    }
+}
+
+bool DA1_HUDScale()
+{
+    // DA1: HUD Scale
+    std::uint8_t* DA1_HUDScaleScanResult = Memory::BatchResult(ScanBatch, Signatures::DA1_HUDScale);
+    if (DA1_HUDScaleScanResult) {
+        spdlog::info("DA1: HUD: HUD Scale: Address is {:s}+{:x}", sExeName.c_str(), DA1_HUDScaleScanResult - (std::uint8_t*)exeModule);
+        static Stubs::Hook DA1_HUDScaleStub{};
+        static SafetyHookMid DA1_HUDScaleMidHook{};
+        QueueStubHook("DA1_HUDScale", DA1_HUDScaleStub, DA1_HUDScaleMidHook, DA1_HUDScaleScanResult, Stubs::kHUDScale,
+            [](SafetyHookContext& ctx) {
+                HOOK_STATS_SCOPE("DA1_HUDScale");
+                HOOK_TRACE_SCOPE(DA1_HUDScale, ctx);
+                Hooks::Call(&Hooks::Callbacks::hudScale, ctx, resolutionState.Load());
+            });
+        return true;
+    }
+    else {
+        spdlog::error("DA1: HUD: HUD Scale: Pattern scan failed.");
+        return false;
+    }
+}
+
+bool DA1_DrawDistance()
+{
+    // DA1: Foliage & Object Draw Distance
+    std::uint8_t* DA1_FoliageDrawDistanceScanResult = Memory::BatchResult(ScanBatch, Signatures::DA1_FoliageDrawDistance);
+    std::uint8_t* DA1_ObjectDrawDistanceScanResult = Memory::BatchResult(ScanBatch, Signatures::DA1_ObjectDrawDistance);
+    if (DA1_FoliageDrawDistanceScanResult && DA1_ObjectDrawDistanceScanResult) {
+        spdlog::info("DA1: Graphics: Draw Distance: Foliage: Scan address is {:s}+{:x}", sExeName.c_str(), DA1_FoliageDrawDistanceScanResult - (std::uint8_t*)exeModule);
+        spdlog::info("DA1: Graphics: Draw Distance: Object: Scan address is {:s}+{:x}", sExeName.c_str(), DA1_ObjectDrawDistanceScanResult - (std::uint8_t*)exeModule);
+
+        FoliageDrawDistance = (std::uint8_t*)*reinterpret_cast<std::uint32_t*>(DA1_FoliageDrawDistanceScanResult + 0x2);
+        spdlog::info("DA1: Graphics: Draw Distance: Foliage: Address is {:s}+{:x}", sExeName.c_str(), FoliageDrawDistance - (std::uint8_t*)exeModule);
+        NPCDrawDistance = (std::uint8_t*)*reinterpret_cast<std::uint32_t*>(DA1_FoliageDrawDistanceScanResult + 0xE);
+        spdlog::info("DA1: Graphics: Draw Distance: NPC: Address is {:s}+{:x}", sExeName.c_str(), NPCDrawDistance - (std::uint8_t*)exeModule);
+
+        ObjectDrawDistance = (std::uint8_t*)*reinterpret_cast<std::uint32_t*>(DA1_ObjectDrawDistanceScanResult + 0x2);
+        spdlog::info("DA1: Graphics: Draw Distance: Object: Address is {:s}+{:x}", sExeName.c_str(), ObjectDrawDistance - (std::uint8_t*)exeModule);
+
+        Patches.Write(FoliageDrawDistance, fFoliageDrawDistance);                   // Default very high = 1.5f
+        Patches.Write(NPCDrawDistance, fNPCDrawDistance);                           // Default very high = 60.0f
+        Patches.Write(ObjectDrawDistance, fObjectDrawDistance);                     // Default = 60.0f
+        return true;
+    }
+    else {
+        spdlog::error("DA1: Graphics: Draw Distance: Pattern scan(s) failed.");
+        return false;
+    }
+}
+
+bool ShadowResolution()
+{
+    // DA1/DA2: Shadow Resolution
+    std::uint8_t* DA1_DA2_ShadowResolutionScanResult = Memory::BatchResult(ScanBatch, Signatures::DA1_DA2_ShadowResolution);
+    if (DA1_DA2_ShadowResolutionScanResult) {
+        spdlog::info("DA1/DA2: Graphics: Shadow Resolution: Address is {:s}+{:x}", sExeName.c_str(), DA1_DA2_ShadowResolutionScanResult - (std::uint8_t*)exeModule);
+        Patches.Write(DA1_DA2_ShadowResolutionScanResult + 0x6, iShadowResolution);
+        spdlog::info("DA1/DA2: Graphics: Shadow Resolution: Queued patch.");
+        return true;
+    }
+    else {
+        spdlog::error("DA1/DA2: Graphics: Shadow Resolution: Pattern scan failed.");
+        return false;
+    }
+}
+
+// Commits every feature's patch group, a group that fails is rolled back on its own. Returns whether each group applied.
+std::vector<bool> ApplyPatches()
+{
+    std::size_t writes = Patches.Writes();
+    std::size_t pages = Patches.Pages();
+    std::size_t hooks = Patches.Steps();
+    auto start = std::chrono::steady_clock::now();
+
+    // Generated stubs go into one arena next to the exe, reserved by the first stub. SafetyHook's trampolines go into the set's own pool.
+    auto exeBase = reinterpret_cast<std::uint8_t*>(exeModule);
+    if (auto layout = Memory::ModuleLayout(exeModule))
+        FixHooks.Near(exeBase, layout->sizeOfImage);
+
+    std::vector<bool> applied = Patches.Commit();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    auto failed = std::count(applied.begin(), applied.end(), false);
+    if (!failed)
+        spdlog::info("Patches: Applied {:d} writes over {:d} pages and {:d} hooks in {:.2f}ms.", writes, pages, hooks, ms);
+    else
+        spdlog::error("Patches: {:d} of {:d} groups failed and were rolled back, the rest of {:d} writes and {:d} hooks applied in {:.2f}ms.",
+            failed, applied.size(), writes, hooks, ms);
+
+    if (FixHooks.ArenaFailed())
+        spdlog::warn("Patches: Couldn't reserve a hook arena near {:s}, stubs went to the hook pool.", sExeName);
+    const auto& arena = FixHooks.CodeArena();
+    if (arena)
+        spdlog::info("Hooks: Arena at {:p}, {:d}/{:d} bytes used, placed after {:d} attempts.", static_cast<const void*>(arena.Base()), arena.Used(), arena.Capacity(), arena.Attempts());
+    for (const auto& entry : FixHooks.Entries()) {
+        spdlog::info("Hooks: {:s}: {:s}+{:x} -> {:p}, {:d} bytes", entry.name, sExeName, entry.target - exeBase, static_cast<const void*>(entry.code), entry.size);
+    }
+    return applied;
+}
+
+// Every feature DAFix installs at startup
+void InstallFeatures()
+{
+    // Seed the resolution snapshot from the desktop, so hooks that read it still work if the resolution hook can't be installed
+    DesktopDimensions = Util::GetPhysicalDesktopDimensions();
+    CalculateAspectRatio(DesktopDimensions.first, DesktopDimensions.second, false);
+
+    using Signatures::kDA1;
+    using Signatures::kDA2;
+
+    Features::Scheduler scheduler;
+    scheduler.Add({ "CurrentResolution", kDA1 | kDA2, 100, { "CurrentResolution" }, {}, {}, CurrentResolution });
+    scheduler.Add({ "DA1_SpeedtreeCulling", kDA1, 50, { "DA1_SpeedtreeCulling" }, {}, [] { return bFixAspect; }, DA1_SpeedtreeCulling });
+    scheduler.Add({ "DA1_ShadowAspectRatio", kDA1, 50, { "DA1_ShadowAspectRatio" }, {}, [] { return bFixAspect; }, DA1_ShadowAspectRatio });
+    scheduler.Add({ "DA1_Pillarboxing", kDA1, 50, { "DA1_Pillarboxing" }, {}, [] { return bDisablePillarboxing; }, DA1_Pillarboxing });
+    scheduler.Add({ "DA2_Pillarboxing", kDA2, 50, { "DA2_Pillarboxing" }, {}, [] { return bDisablePillarboxing; }, DA2_Pillarboxing });
+    scheduler.Add({ "DialogFOV", kDA1 | kDA2, 50, { "GameInit" }, {}, [] { return bDisablePillarboxing; }, DialogFOV });
+    scheduler.Add({ "DA1_HUDScale", kDA1, 40, { "DA1_HUDScale" }, {}, [] { return fHUDScale >= 0.00f && fHUDScale <= 1.00f; }, DA1_HUDScale });
+    scheduler.Add({ "DA1_Borderless", kDA1, 30, { "DA1_Borderless" }, {}, [] { return bBorderlessWindowed; }, DA1_Borderless });
+    scheduler.Add({ "DA2_Borderless", kDA2, 30, { "DA2_Borderless" }, {}, [] { return bBorderlessWindowed; }, DA2_Borderless });
+    scheduler.Add({ "DA1_DrawDistance", kDA1, 10, { "DA1_FoliageDrawDistance", "DA1_ObjectDrawDistance" }, {},
+        [] { return fFoliageDrawDistance > 0.00f && fNPCDrawDistance > 0.00f && fObjectDrawDistance > 0.00f; }, DA1_DrawDistance });
+    scheduler.Add({ "ShadowResolution", kDA1 | kDA2, 10, { "DA1_DA2_ShadowResolution" }, {}, {}, ShadowResolution });
+
+    // Only scan for what the enabled features need
+    unsigned gameMask = eGameType == Game::DA1 ? kDA1 : eGameType == Game::DA2 ? kDA2 : 0;
+    auto selected = scheduler.Select(gameMask);
+    std::vector<std::string_view> needed;
+    for (const auto* feature : selected)
+        needed.insert(needed.end(), feature->signatures.begin(), feature->signatures.end());
+    ScanSignatures(gameMask, needed);
+
+    // Installing only resolves addresses and queues patches into the feature's own group, ApplyPatches() commits them
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::size_t> groups(scheduler.Results().size());
+    std::vector<Features::Result> results = scheduler.Run([&](std::size_t feature) { groups[feature] = Patches.Group(); });
+    std::vector<bool> applied = ApplyPatches();
+
+    // Only report a feature installed once its patches are in
+    std::size_t installed = 0;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        auto& result = results[i];
+        bool bRolledBack = result.status == Features::Status::Installed && !applied[groups[i]];
+        if (bRolledBack)
+            result.status = Features::Status::Failed;
+        if (result.status == Features::Status::Installed)
+            ++installed;
+        if (result.blockedBy)
+            spdlog::warn("Features: {:s}: {:s}, needs {:s}.", result.name, Features::StatusName(result.status), result.blockedBy);
+        else if (bRolledBack)
+            spdlog::error("Features: {:s}: {:s}, patches rolled back.", result.name, Features::StatusName(result.status));
+        else
+            spdlog::info("Features: {:s}: {:s} ({:.2f}ms)", result.name, Features::StatusName(result.status), result.ms);
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("Features: {:d}/{:d} enabled features installed in {:.2f}ms.", installed, selected.size(), elapsed);
+    spdlog::info("----------");
+}
+
+// Present from a throwaway NULLREF device, every device in the process shares the vtable
+void* D3D9Present()
+{
+    HMODULE d3d9Module = GetModuleHandleW(L"d3d9.dll");
+    auto Direct3DCreate9 = d3d9Module ? reinterpret_cast<IDirect3D9*(WINAPI*)(UINT)>(GetProcAddress(d3d9Module, "Direct3DCreate9")) : nullptr;
+    IDirect3D9* d3d9 = Direct3DCreate9 ? Direct3DCreate9(D3D_SDK_VERSION) : nullptr;
+    if (!d3d9)
+        return nullptr;
+
+    void* present = nullptr;
+    HWND hWnd = CreateWindowExW(0, L"STATIC", L"DAFix", WS_OVERLAPPEDWINDOW, 0, 0, 16, 16, NULL, NULL, NULL, NULL);
+    D3DPRESENT_PARAMETERS params = {};
+    params.Windowed = TRUE;
+    params.SwapEffect = D3DSWAPEFFECT_DISCARD;
+    params.hDeviceWindow = hWnd;
+    IDirect3DDevice9* device = nullptr;
+    if (hWnd && !FAILED(d3d9->CreateDevice(D3DADAPTER_DEFAULT, D3DDEVTYPE_NULLREF, hWnd, D3DCREATE_SOFTWARE_VERTEXPROCESSING | D3DCREATE_DISABLE_DRIVER_MANAGEMENT, &params, &device))) {
+        present = (*reinterpret_cast<void***>(device))[17];
+        device->Release();
+    }
+    if (hWnd)
+        DestroyWindow(hWnd);
+    d3d9->Release();
+    return present;
+}
+
+SafetyHookInline PresentHook{};
+HRESULT WINAPI Present(IDirect3DDevice9* device, const RECT* sourceRect, const RECT* destRect, HWND hDestWindowOverride, const RGNDATA* dirtyRegion)
+{
+    if (fFrameLimit > 0.00f) {
+        static Pacing::SteadyClock pacerClock;
+        static Pacing::ThreadSleeper pacerSleeper;
+        static Pacing::FramePacer framePacer(pacerClock, pacerSleeper, fFrameLimit);
+        framePacer.Wait();
+    }
+
+    std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    frameTimer.Present(now);
+    if (bFrameTelemetry)
+        frameTimestamps.Push(now);
+    return PresentHook.stdcall<HRESULT>(device, sourceRect, destRect, hDestWindowOverride, dirtyRegion);
+}
+
+// Per-frame hook shared by the governor and frame telemetry, installed on first use
+bool FrameHook()
+{
+    if (PresentHook)
+        return true;
+
+    void* D3D9PresentAddress = D3D9Present();
+    if (!D3D9PresentAddress) {
+        spdlog::error("Frame Hook: Failed to locate IDirect3DDevice9::Present, is the game using D3D9?");
+        return false;
+    }
+    spdlog::info("Frame Hook: Present is d3d9.dll+{:x}", (std::uint8_t*)D3D9PresentAddress - (std::uint8_t*)GetModuleHandleW(L"d3d9.dll"));
+
+    PresentHook = safetyhook::create_inline(D3D9PresentAddress, reinterpret_cast<void*>(Present));
+    if (!PresentHook) {
+        spdlog::error("Frame Hook: Failed to hook Present.");
+        return false;
+    }
+    return true;
+}
+
+void DrawDistanceGovernor()
+{
+    if (eGameType == Game::DA1 && bDrawDistanceGovernor && FoliageDrawDistance && NPCDrawDistance && ObjectDrawDistance) {
+        // DA1: Draw Distance Governor
+        if (!FrameHook()) {
+            spdlog::error("DA1: Graphics: Draw Distance Governor: No frame times, governor disabled.");
+            return;
         }
-        else {
-            spdlog::error("DA1/DA2: FOV: Dialog: Pattern scan failed.");
+
+        // The draw distances are constants in the exe, make them writable once. Each change is then three aligned 32-bit
+        // stores, atomic on x86, so the game never reads a torn value and no other thread has to be suspended.
+        for (std::uint8_t* address : { FoliageDrawDistance, NPCDrawDistance, ObjectDrawDistance }) {
+            DWORD oldProtect;
+            if (!VirtualProtect(address, sizeof(float), PAGE_EXECUTE_WRITECOPY, &oldProtect)) {
+                spdlog::error("DA1: Graphics: Draw Distance Governor: Failed to unprotect {:s}+{:x}, governor disabled.", sExeName.c_str(), address - (std::uint8_t*)exeModule);
+                return;
+            }
         }
+
+        // Re-evaluate twice a second, the [Draw Distances] values are the maximums
+        std::thread([] {
+            auto store = [](std::uint8_t* address, float value) {
+                std::atomic_ref(*reinterpret_cast<float*>(address)).store(value, std::memory_order_relaxed);
+            };
+            Governor::Settings settings;
+            settings.targetFrameMs = fGovernorTargetFrameTime;
+            Governor::Controller controller(settings);
+            for (;;) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                if (!controller.Update(frameTimer.TakeMeanMs()))
+                    continue;
+
+                float scale = controller.Scale();
+                store(FoliageDrawDistance, Governor::Lerp(fGovernorMinFoliage, fFoliageDrawDistance, scale));
+                store(NPCDrawDistance, Governor::Lerp(fGovernorMinNPC, fNPCDrawDistance, scale));
+                store(ObjectDrawDistance, Governor::Lerp(fGovernorMinObject, fObjectDrawDistance, scale));
+                ASYNC_LOG(Info, "DA1: Graphics: Draw Distance Governor: Frame time {:.2f}ms, scale {:.2f}", controller.SmoothedMs(), scale);
+            }
+        }).detach();
+        spdlog::info("DA1: Graphics: Draw Distance Governor: Targeting {:.2f}ms frame time.", fGovernorTargetFrameTime);
     }
 }
 
-void HUD()
-{
-    if (eGameType == Game::DA1 && fHUDScale >= 0.00f && fHUDScale <= 1.00f) {
-        // DA1: HUD Scale
-        std::uint8_t* DA1_HUDScaleScanResult = Memory::PatternScan(exeModule, "D9 ?? ?? ?? 8B ?? D9 ?? ?? ?? D9 ?? ?? ?? 8B ?? ?? 53");
-        if (DA1_HUDScaleScanResult) {
-            spdlog::info("DA1: HUD: HUD Scale: Address is {:s}+{:x}", sExeName.c_str(), DA1_HUDScaleScanResult - (std::uint8_t*)exeModule);
-            static SafetyHookMid DA1_HUDScaleMidHook{};
-            DA1_HUDScaleMidHook = safetyhook::create_mid(DA1_HUDScaleScanResult,
-                [](SafetyHookContext& ctx) {
-                    if (ctx.esp) {
-                        if (fHUDScale == 0.00f) {
-                            // Automatic HUD scale
-                            if (fAspectRatio > 1.333333f && iCurrentResY > 768) {
-                                *reinterpret_cast<float*>(ctx.esp + 0x08) = 768.00f / (float)iCurrentResY;
-                            }
-                            else if (fAspectRatio <= 1.33333f && iCurrentResX > 1024) {
-                                *reinterpret_cast<float*>(ctx.esp + 0x08) = 1024.00f / (float)iCurrentResX;
-                            }
-                        }
-                        else {
-                            // Custom HUD scale
-                            *reinterpret_cast<float*>(ctx.esp + 0x08) = fHUDScale;
-                        }
-                    }
-                });
-        }
-        else {
-            spdlog::error("DA1: HUD: HUD Scale: Pattern scan failed.");
-        }       
+void FrameLimiter()
+{
+    if (fFrameLimit <= 0.00f)
+        return;
+    if (!FrameHook()) {
+        spdlog::error("Frame Limiter: No per-frame hook, limiter disabled.");
+        return;
     }
+    spdlog::info("Frame Limiter: Limiting to {:.2f} fps.", fFrameLimit);
 }
 
-void Graphics()
+void FrameTelemetry()
 {
-    if (eGameType == Game::DA1 && fFoliageDrawDistance > 0.00f && fNPCDrawDistance > 0.00f && fObjectDrawDistance > 0.00f) {
-        // DA1: Foliage & Object Draw Distance
-        std::uint8_t* DA1_FoliageDrawDistanceScanResult = Memory::PatternScan(exeModule, "D9 ?? ?? ?? ?? ?? D9 ?? ?? ?? ?? ?? D9 ?? ?? ?? ?? ?? EB ?? D9 ?? ?? ?? ?? ?? D9 ?? ?? ?? ?? ??");
-        std::uint8_t* DA1_ObjectDrawDistanceScanResult = Memory::PatternScan(exeModule, "D9 ?? ?? ?? ?? ?? DE ?? DF ?? F6 ?? ?? 74 ?? C6 ?? ?? ?? 00");
-        if (DA1_FoliageDrawDistanceScanResult && DA1_ObjectDrawDistanceScanResult) {
-            spdlog::info("DA1: Graphics: Draw Distance: Foliage: Scan address is {:s}+{:x}", sExeName.c_str(), DA1_FoliageDrawDistanceScanResult - (std::uint8_t*)exeModule);
-            spdlog::info("DA1: Graphics: Draw Distance: Object: Scan address is {:s}+{:x}", sExeName.c_str(), DA1_ObjectDrawDistanceScanResult - (std::uint8_t*)exeModule);
+    if (!bFrameTelemetry)
+        return;
+    if (!FrameHook()) {
+        spdlog::error("Frame Telemetry: No frame times, telemetry disabled.");
+        return;
+    }
 
-            std::uint8_t* FoliageDrawDistance = (std::uint8_t*)*reinterpret_cast<std::uint32_t*>(DA1_FoliageDrawDistanceScanResult + 0x2);
-            spdlog::info("DA1: Graphics: Draw Distance: Foliage: Address is {:s}+{:x}", sExeName.c_str(), FoliageDrawDistance - (std::uint8_t*)exeModule);
-            std::uint8_t* NPCDrawDistance = (std::uint8_t*)*reinterpret_cast<std::uint32_t*>(DA1_FoliageDrawDistanceScanResult + 0xE);
-            spdlog::info("DA1: Graphics: Draw Distance: NPC: Address is {:s}+{:x}", sExeName.c_str(), NPCDrawDistance - (std::uint8_t*)exeModule);
+    std::ofstream csvFile(sFixPath.string() + sTelemetryFile, std::ios::trunc);
+    if (!csvFile) {
+        spdlog::error("Frame Telemetry: Failed to open {:s}", sFixPath.string() + sTelemetryFile);
+        return;
+    }
+    spdlog::info("Frame Telemetry: Writing frame times to {:s}", sFixPath.string() + sTelemetryFile);
 
-            std::uint8_t* ObjectDrawDistance = (std::uint8_t*)*reinterpret_cast<std::uint32_t*>(DA1_ObjectDrawDistanceScanResult + 0x2);
-            spdlog::info("DA1: Graphics: Draw Distance: Object: Address is {:s}+{:x}", sExeName.c_str(), ObjectDrawDistance - (std::uint8_t*)exeModule);
+    // Drain the ring every 100ms, the render thread only ever pushes
+    std::thread([csvFile = std::move(csvFile)]() mutable {
+        csvFile << "frame,timestamp_ms,frame_ms\n";
+        Telemetry::Capture capture;
+        std::int64_t firstNs = 0;
+        auto reportInterval = std::chrono::seconds(std::max(iTelemetryReportInterval, 1));
+        auto reportTime = std::chrono::steady_clock::now() + reportInterval;
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::int64_t timestampNs;
+            while (frameTimestamps.Pop(timestampNs)) {
+                if (!firstNs)
+                    firstNs = timestampNs;
+                double frameMs = capture.Add(timestampNs);
+                csvFile << capture.Frames() << ',' << (timestampNs - firstNs) / 1'000'000.0 << ',' << frameMs << '\n';
+            }
 
-            Memory::Write(FoliageDrawDistance, fFoliageDrawDistance);                   // Default very high = 1.5f
-            Memory::Write(NPCDrawDistance, fNPCDrawDistance);                           // Default very high = 60.0f
-            Memory::Write(ObjectDrawDistance, fObjectDrawDistance);                     // Default = 60.0f
-        }
-        else {
-            spdlog::error("DA1: Graphics: Draw Distance: Pattern scan(s) failed.");
-        }     
-    }
-
-    if (eGameType == Game::DA1 || eGameType == Game::DA2) {
-        // DA1/DA2: Shadow Resolution
-        std::uint8_t* DA1_DA2_ShadowResolutionScanResult = Memory::MultiPatternScan(exeModule, { "C7 ?? ?? ?? ?? ?? 00 04 00 00 56 57 E8 ?? ?? ?? ??", "C7 ?? ?? ?? ?? ?? 00 10 00 00 E8 ?? ?? ?? ?? 8B ?? 8B ?? 8B ?? ?? FF ??" });
-        if (DA1_DA2_ShadowResolutionScanResult) {
-            spdlog::info("DA1/DA2: Graphics: Shadow Resolution: Address is {:s}+{:x}", sExeName.c_str(), DA1_DA2_ShadowResolutionScanResult - (std::uint8_t*)exeModule);
-            Memory::Write(DA1_DA2_ShadowResolutionScanResult + 0x6, iShadowResolution);
-            spdlog::info("DA1/DA2: Graphics: Shadow Resolution: Patched instruction.");
+            if (std::chrono::steady_clock::now() >= reportTime) {
+                reportTime += reportInterval;
+                csvFile.flush();
+                Telemetry::Report report = capture.TakeReport();
+                if (report.frames) {
+                    spdlog::info("Frame Telemetry: {:d} frames, avg {:.1f} fps, 1% low {:.1f} fps, 0.1% low {:.1f} fps, max {:.2f}ms, {:d} stutters, {:d} dropped",
+                        report.frames, report.averageFps, report.low1Fps, report.low01Fps, report.maxFrameMs, report.stutters, frameTimestamps.Dropped());
+                }
+            }
         }
-        else {
-            spdlog::error("DA1/DA2: Graphics: Shadow Resolution: Pattern scan failed.");
+    }).detach();
+}
+
+#if defined(DAFIX_HOOK_STATS)
+void HookStatsSummary()
+{
+    // Log hook call rates and latencies every 10s, Main has nothing else to do once hooks are in
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::seconds(10));
+        for (const auto& summary : HookStats::Registry::Global().Collect()) {
+            spdlog::info("Hook Stats: {:s}: {:d} calls ({:.1f}/s), mean {:.0f}ns, p50 <{:.0f}ns, p99 <{:.0f}ns, {:d} total",
+                summary.name, summary.calls, summary.callsPerSec, summary.meanNs, summary.p50Ns, summary.p99Ns, summary.totalCalls);
         }
     }
 }
+#endif
+
+#if defined(DAFIX_HOOK_TRACE)
+void StartHookTrace()
+{
+    // Before any hook is queued, so the trace also holds the first resolution snapshot
+    unsigned gameMask = eGameType == Game::DA1 ? Signatures::kDA1 : eGameType == Game::DA2 ? Signatures::kDA2 : 0;
+    if (HookTrace::Writer::Global().Start(sFixPath / sTraceFile, gameMask, fHUDScale))
+        spdlog::info("Hook Trace: Writing hook contexts to {:s}", (sFixPath / sTraceFile).string());
+    else
+        spdlog::error("Hook Trace: Failed to open {:s}", (sFixPath / sTraceFile).string());
+}
+#endif
 
 DWORD __stdcall Main(void*)
 {
     Logging();
     Configuration();
     if (DetectGame()) {
+        StartDiskScan();
+#if defined(DAFIX_HOOK_TRACE)
+        StartHookTrace();
+#endif
         GameInit();
-        CurrentResolution();
-        WindowManagement();
-        AspectRatio();
-        FOV();
-        HUD();
-        Graphics();
+        InstallFeatures();
+        DrawDistanceGovernor();
+        FrameLimiter();
+        FrameTelemetry();
+#if defined(DAFIX_HOOK_STATS)
+        HookStatsSummary();
+#endif
     }
     return true;
 }
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+// Features as data: which games they apply to, their config gate, the signatures they need, what they depend on and how
+// to install them. The Scheduler installs every enabled feature once its dependencies have, highest priority first.
+// Installs only resolve addresses and queue patches, so they run on the calling thread.
+// Platform-neutral so the ordering can be checked with stub features (see tools/dafix-bench.cpp).
+namespace Features
+{
+    enum class Status
+    {
+        Pending,
+        Disabled,       // Other game or turned off in the config
+        Installed,
+        Failed,         // Install returned false
+        Skipped,        // A dependency didn't install, or a dependency cycle
+    };
+
+    inline const char* StatusName(Status status)
+    {
+        switch (status) {
+        case Status::Pending: return "pending";
+        case Status::Disabled: return "disabled";
+        case Status::Installed: return "installed";
+        case Status::Failed: return "failed";
+        case Status::Skipped: return "skipped";
+        }
+        return "unknown";
+    }
+
+    struct Feature
+    {
+        const char* name;
+        unsigned games;
+        int priority = 0;                           // Higher installs first among ready features
+        std::vector<const char*> signatures;        // Signatures::Entry::feature names to scan for
+        std::vector<const char*> dependencies;      // Feature names that must install first
+        std::function<bool()> enabled;              // Config gate, empty means always on
+        std::function<bool()> install;              // Resolve addresses and queue patches, false if anything is missing
+    };
+
+    struct Result
+    {
+        const char* name;
+        Status status = Status::Pending;
+        double ms = 0.0;
+        const char* blockedBy = nullptr;    // Dependency that kept a skipped feature from installing
+    };
+
+    class Scheduler
+    {
+    public:
+        void Add(Feature feature)
+        {
+            features.push_back(std::move(feature));
+            results.push_back({ features.back().name });
+        }
+
+        // Evaluates game masks and config gates. Returns the enabled features, whose signatures need resolving before Run().
+        std::vector<const Feature*> Select(unsigned game)
+        {
+            std::vector<const Feature*> selected;
+            for (std::size_t i = 0; i < features.size(); ++i) {
+                const Feature& feature = features[i];
+                bool bEnabled = (feature.games & game) && (!feature.enabled || feature.enabled());
+                results[i].status = bEnabled ? Status::Pending : Status::Disabled;
+                if (bEnabled)
+                    selected.push_back(&feature);
+            }
+            return selected;
+        }
+
+        // Installs every selected feature on the calling thread, in dependency then priority order.
+        // before is called with the feature's index (in Add() order, as Results()) right before each install.
+        const std::vector<Result>& Run(const std::function<void(std::size_t)>& before = {})
+        {
+            for (std::size_t next = NextReady(); next < features.size(); next = NextReady()) {
+                if (before)
+                    before(next);
+                auto start = std::chrono::steady_clock::now();
+                bool bInstalled = features[next].install();
+                results[next].ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                results[next].status = bInstalled ? Status::Installed : Status::Failed;
+            }
+
+            // Nothing ready but some still pending: the rest depend on each other
+            for (auto& result : results) {
+                if (result.status == Status::Pending)
+                    result.status = Status::Skipped;
+            }
+            return results;
+        }
+
+        const std::vector<Result>& Results() const { return results; }
+
+    private:
+        std::size_t Find(std::string_view name) const
+        {
+            for (std::size_t i = 0; i < features.size(); ++i) {
+                if (name == features[i].name)
+                    return i;
+            }
+            return features.size();
+        }
+
+        // Picks the highest priority pending feature whose dependencies all installed. Skips features with a dependency
+        // that can no longer install, which may unblock nothing but lets the rest of the queue drain.
+        std::size_t NextReady()
+        {
+            for (bool bChanged = true; bChanged;) {
+                bChanged = false;
+                for (std::size_t i = 0; i < features.size(); ++i) {
+                    if (results[i].status != Status::Pending)
+                        continue;
+                    for (const char* dependency : features[i].dependencies) {
+                        std::size_t index = Find(dependency);
+                        Status status = index < features.size() ? results[index].status : Status::Disabled;
+                        if (status == Status::Disabled || status == Status::Failed || status == Status::Skipped) {
+                            results[i].status = Status::Skipped;
+                            results[i].blockedBy = dependency;
+                            bChanged = true;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            std::size_t best = features.size();
+            for (std::size_t i = 0; i < features.size(); ++i) {
+                if (results[i].status != Status::Pending)
+                    continue;
+                bool bReady = std::all_of(features[i].dependencies.begin(), features[i].dependencies.end(),
+                    [&](const char* dependency) { return results[Find(dependency)].status == Status::Installed; });
+                if (bReady && (best == features.size() || features[i].priority > features[best].priority))
+                    best = i;
+            }
+            return best;
+        }
+
+        std::vector<Feature> features;
+        std::vector<Result> results;
+    };
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Frame limiter: sleeps most of the way to each frame's deadline, then spins the rest.
+// Sleep overshoot is measured every frame and the spin window follows it, so pacing stays tight without spinning longer than needed.
+// Written against a Clock (Now() in ns) and a Sleeper (Sleep(ns), Spin()) so it can run on simulated time (see tools/dafix-bench.cpp).
+namespace Pacing
+{
+    constexpr std::int64_t kMinSpinNs = 200'000;        // Always leave the last 0.2ms to the spin loop
+    constexpr std::int64_t kMaxSpinNs = 4'000'000;      // Cap the calibrated window in case the OS stalls us once
+    constexpr std::int64_t kInitialOversleepNs = 1'000'000;
+
+    struct SteadyClock
+    {
+        std::int64_t Now() const
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    };
+
+    inline void Pause()
+    {
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+        _mm_pause();
+#endif
+    }
+
+#if defined(_WIN32)
+    // High resolution waitable timer (Windows 10 1803+), falls back to Sleep() and its coarse granularity without one
+    class ThreadSleeper
+    {
+    public:
+        ThreadSleeper() : timer(CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS)) {}
+        ~ThreadSleeper()
+        {
+            if (timer)
+                CloseHandle(timer);
+        }
+
+        ThreadSleeper(const ThreadSleeper&) = delete;
+        ThreadSleeper& operator=(const ThreadSleeper&) = delete;
+
+        void Sleep(std::int64_t ns)
+        {
+            LARGE_INTEGER due;
+            due.QuadPart = -(ns / 100);     // Relative, in 100ns units
+            if (timer && SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE))
+                WaitForSingleObject(timer, INFINITE);
+            else
+                ::Sleep(static_cast<DWORD>(ns / 1'000'000));
+        }
+
+        void Spin() { Pause(); }
+
+    private:
+        HANDLE timer;
+    };
+#else
+    struct ThreadSleeper
+    {
+        void Sleep(std::int64_t ns) { std::this_thread::sleep_for(std::chrono::nanoseconds(ns)); }
+        void Spin() { Pause(); }
+    };
+#endif
+
+    struct Stats
+    {
+        std::uint64_t frames = 0;
+        std::int64_t sleptNs = 0;
+        std::int64_t spunNs = 0;
+        std::uint64_t missed = 0;       // Frames that arrived after their deadline, nothing to wait for
+    };
+
+    template<typename Clock, typename Sleeper>
+    class FramePacer
+    {
+    public:
+        FramePacer(Clock& clock, Sleeper& sleeper, double fps = 0.0) : clock(clock), sleeper(sleeper) { SetTarget(fps); }
+
+        // 0 disables the limiter
+        void SetTarget(double fps)
+        {
+            intervalNs = fps > 0.0 ? static_cast<std::int64_t>(1'000'000'000.0 / fps) : 0;
+            deadlineNs = 0;
+        }
+
+        // Call once per frame, right before presenting. Returns once the frame's slot is reached.
+        void Wait()
+        {
+            if (!intervalNs)
+                return;
+
+            std::int64_t now = clock.Now();
+            if (!deadlineNs || now - deadlineNs > intervalNs) {
+                // First frame or a hitch longer than a frame: restart the schedule instead of rushing to catch up
+                deadlineNs = now + intervalNs;
+                ++stats.frames;
+                return;
+            }
+            if (now >= deadlineNs) {
+                ++stats.missed;
+            }
+            else {
+                std::int64_t sleepNs = deadlineNs - now - SpinWindow();
+                if (sleepNs > 0) {
+                    sleeper.Sleep(sleepNs);
+                    std::int64_t woke = clock.Now();
+                    Calibrate(woke - now - sleepNs);
+                    stats.sleptNs += woke - now;
+                    now = woke;
+                }
+                while (now < deadlineNs) {
+                    sleeper.Spin();
+                    std::int64_t spun = clock.Now();
+                    stats.spunNs += spun - now;
+                    now = spun;
+                }
+            }
+            deadlineNs += intervalNs;
+            ++stats.frames;
+        }
+
+        // Oversleep allowance: mean overshoot plus three mean deviations, clamped
+        std::int64_t SpinWindow() const
+        {
+            return std::clamp(static_cast<std::int64_t>(oversleepNs + 3.0 * deviationNs), kMinSpinNs, kMaxSpinNs);
+        }
+
+        const Stats& GetStats() const { return stats; }
+
+    private:
+        void Calibrate(std::int64_t overshootNs)
+        {
+            constexpr double kWeight = 0.10;
+            double error = static_cast<double>(std::max<std::int64_t>(overshootNs, 0)) - oversleepNs;
+            oversleepNs += kWeight * error;
+            deviationNs += kWeight * (std::abs(error) - deviationNs);
+        }
+
+        Clock& clock;
+        Sleeper& sleeper;
+        std::int64_t intervalNs = 0;
+        std::int64_t deadlineNs = 0;
+        double oversleepNs = kInitialOversleepNs;
+        double deviationNs = 0.0;
+        Stats stats;
+    };
+}
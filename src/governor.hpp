@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+// Draw distance governor: scales the DA1 draw distances between configured minimums and maximums to hold a target frame time.
+// Free of Windows and the game, the Present hook feeds FrameTimer and a background thread drives Controller,
+// so the control loop can be replayed against simulated frame time traces (see tools/dafix-bench.cpp).
+namespace Governor
+{
+    struct Settings
+    {
+        float targetFrameMs = 16.7f;
+        float deadband = 0.10f;     // Hold while the smoothed frame time is within this fraction of the target
+        float smoothing = 0.30f;    // EMA weight of each new interval's mean frame time
+        float stepDown = 0.10f;     // Scale change per update when over budget
+        float stepUp = 0.02f;       // Recover slower than we back off so a short dip doesn't bounce straight back
+    };
+
+    // Value at scale between the minimum (0) and the maximum (1)
+    inline float Lerp(float minimum, float maximum, float scale)
+    {
+        return minimum + (maximum - minimum) * scale;
+    }
+
+    // Accumulates frame times from the render thread, read and reset once per interval by the governor thread.
+    // Sum and count share one atomic so an interval never sees a frame's time without its count.
+    class FrameTimer
+    {
+    public:
+        static constexpr std::int64_t kMaxFrameNs = 250'000'000;   // Longer gaps are loading screens or alt-tab, not frames
+
+        // Render thread only
+        void Present(std::int64_t nowNs)
+        {
+            std::int64_t frameNs = nowNs - lastNs;
+            if (lastNs && frameNs > 0 && frameNs < kMaxFrameNs)
+                packed.fetch_add((static_cast<std::uint64_t>(frameNs / 1000) << kCountBits) | 1, std::memory_order_relaxed);
+            lastNs = nowNs;
+        }
+
+        // Mean frame time since the previous call, 0 if no frames were presented
+        double TakeMeanMs()
+        {
+            std::uint64_t value = packed.exchange(0, std::memory_order_relaxed);
+            std::uint64_t count = value & ((std::uint64_t(1) << kCountBits) - 1);
+            std::uint64_t sumUs = value >> kCountBits;
+            return count ? static_cast<double>(sumUs) / count / 1000.0 : 0.0;
+        }
+
+    private:
+        static constexpr unsigned kCountBits = 20;  // ~1M frames per interval, leaves 44 bits of microseconds
+
+        std::int64_t lastNs = 0;
+        std::atomic<std::uint64_t> packed = 0;
+    };
+
+    class Controller
+    {
+    public:
+        explicit Controller(const Settings& settings, float scale = 1.00f) : settings(settings), scale(std::clamp(scale, 0.00f, 1.00f)) {}
+
+        // Feed one interval's mean frame time, returns true if the scale changed
+        bool Update(double meanFrameMs)
+        {
+            if (meanFrameMs <= 0.0 || settings.targetFrameMs <= 0.00f)
+                return false;
+
+            smoothedMs = bPrimed ? smoothedMs + settings.smoothing * (meanFrameMs - smoothedMs) : meanFrameMs;
+            bPrimed = true;
+
+            double ratio = smoothedMs / settings.targetFrameMs;
+            float previous = scale;
+            if (ratio > 1.0 + settings.deadband)
+                scale = std::max(0.00f, scale - settings.stepDown);
+            else if (ratio < 1.0 - settings.deadband)
+                scale = std::min(1.00f, scale + settings.stepUp);
+            return scale != previous;
+        }
+
+        float Scale() const { return scale; }
+        double SmoothedMs() const { return smoothedMs; }
+
+    private:
+        Settings settings;
+        float scale;
+        double smoothedMs = 0.0;
+        bool bPrimed = false;
+    };
+}
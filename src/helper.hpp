@@ -1,7 +1,15 @@
 #include "stdafx.h"
+#include "patch.hpp"
+#include "pe.hpp"
+#include "scancache.hpp"
+#include "scanner.hpp"
 
 namespace Memory
 {
+    // Collects writes and hook installs, see Patch::Transaction
+    using PatchTransaction = Patch::Transaction<Patch::Protect::Native>;
+
+    // Standalone writes, patches applied at startup are queued into a PatchTransaction instead
     template<typename T>
     void Write(std::uint8_t* writeAddress, T value)
     {
@@ -19,54 +27,101 @@ namespace Memory
         VirtualProtect((LPVOID)address, numBytes, oldProtect, &oldProtect);
     }
 
-    std::vector<int> pattern_to_byte(const char* pattern)
+    // Splits [address, address + size) into committed, readable sub-ranges
+    std::vector<std::pair<std::uint8_t*, std::size_t>> ReadableRanges(std::uint8_t* address, std::size_t size)
     {
-        auto bytes = std::vector<int>{};
-        auto start = const_cast<char*>(pattern);
-        auto end = const_cast<char*>(pattern) + strlen(pattern);
-
-        for (auto current = start; current < end; ++current) {
-            if (*current == '?') {
-                ++current;
-                if (*current == '?')
-                    ++current;
-                bytes.push_back(-1);
-            }
-            else {
-                bytes.push_back(strtoul(current, &current, 16));
+        constexpr DWORD kReadable = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+        std::vector<std::pair<std::uint8_t*, std::size_t>> ranges;
+        std::uint8_t* current = address;
+        std::uint8_t* end = address + size;
+        while (current < end) {
+            MEMORY_BASIC_INFORMATION mbi;
+            if (!VirtualQuery(current, &mbi, sizeof(mbi)))
+                break;
+
+            std::uint8_t* regionEnd = reinterpret_cast<std::uint8_t*>(mbi.BaseAddress) + mbi.RegionSize;
+            if (regionEnd > end)
+                regionEnd = end;
+            bool bReadable = mbi.State == MEM_COMMIT && (mbi.Protect & kReadable) && !(mbi.Protect & PAGE_GUARD);
+            if (bReadable) {
+                if (!ranges.empty() && ranges.back().first + ranges.back().second == current)
+                    ranges.back().second += regionEnd - current;
+                else
+                    ranges.emplace_back(current, regionEnd - current);
             }
+            current = regionEnd;
         }
-        return bytes;
+        return ranges;
     }
 
-    std::uint8_t* PatternScan(void* module, const char* signature) {
-        auto dosHeader = (PIMAGE_DOS_HEADER)module;
-        auto ntHeaders = (PIMAGE_NT_HEADERS)((std::uint8_t*)module + dosHeader->e_lfanew);
+    bool IsReadable(std::uint8_t* address, std::size_t size)
+    {
+        auto ranges = ReadableRanges(address, size);
+        return ranges.size() == 1 && ranges.front().first == address && ranges.front().second == size;
+    }
 
-        auto sizeOfImage = ntHeaders->OptionalHeader.SizeOfImage;
-        auto patternBytes = pattern_to_byte(signature);
-        auto scanBytes = reinterpret_cast<std::uint8_t*>(module);
+    std::optional<PE::Layout> ModuleLayout(void* module)
+    {
+        // Headers live in the first page of the module
+        auto headers = ReadableRanges(reinterpret_cast<std::uint8_t*>(module), 0x1000);
+        if (headers.empty() || headers.front().first != module)
+            return std::nullopt;
+        return PE::Parse(headers.front().first, headers.front().second);
+    }
 
-        auto s = patternBytes.size();
-        auto d = patternBytes.data();
+    // Readable address ranges of module that fall inside region
+    std::vector<std::pair<std::uint8_t*, std::size_t>> ScanRanges(void* module, PE::Region region)
+    {
+        auto base = reinterpret_cast<std::uint8_t*>(module);
+        std::vector<PE::Range> sectionRanges;
+        if (auto layout = ModuleLayout(module)) {
+            sectionRanges = layout->ImageRanges(region);
+        }
+        else {
+            auto dosHeader = (PIMAGE_DOS_HEADER)module;
+            auto ntHeaders = (PIMAGE_NT_HEADERS)(base + dosHeader->e_lfanew);
+            sectionRanges.push_back({ 0, ntHeaders->OptionalHeader.SizeOfImage });
+        }
 
-        for (auto i = 0ul; i < sizeOfImage - s; ++i) {
-            bool found = true;
-            for (auto j = 0ul; j < s; ++j) {
-                if (scanBytes[i + j] != d[j] && d[j] != -1) {
-                    found = false;
-                    break;
-                }
-            }
-            if (found) {
-                return &scanBytes[i];
+        std::vector<std::pair<std::uint8_t*, std::size_t>> ranges;
+        for (const auto& sectionRange : sectionRanges) {
+            auto readable = ReadableRanges(base + sectionRange.offset, sectionRange.size);
+            ranges.insert(ranges.end(), readable.begin(), readable.end());
+        }
+        return ranges;
+    }
+
+    std::uint8_t* PatternScan(void* module, const Scanner::PatternView& pattern, PE::Region region = PE::Region::Code) {
+        // SIMD anchor search over readable sections only, split across cores for large sections
+        for (const auto& [scanBytes, size] : ScanRanges(module, region)) {
+            if (auto result = Scanner::FindParallel(scanBytes, size, pattern)) {
+                return const_cast<std::uint8_t*>(result);
             }
         }
+        return nullptr;
+    }
+
+    // Byte frequencies of the module's readable sections in region, see Scanner::Anchor()
+    Scanner::Profile ModuleProfile(void* module, PE::Region region = PE::Region::Code)
+    {
+        Scanner::Profile profile;
+        for (const auto& [scanBytes, size] : ScanRanges(module, region))
+            profile.Sample(scanBytes, size);
+        return profile;
+    }
 
+    // Searches outward from hint within the range holding it, see Scanner::FindNear(). nullptr if hint isn't in ranges or nothing is close.
+    std::uint8_t* NearPatternScan(const std::vector<std::pair<std::uint8_t*, std::size_t>>& ranges, const Scanner::PatternView& pattern, std::uint8_t* hint)
+    {
+        for (const auto& [scanBytes, size] : ranges) {
+            if (hint >= scanBytes && hint < scanBytes + size)
+                return const_cast<std::uint8_t*>(Scanner::FindNear(scanBytes, size, hint - scanBytes, pattern));
+        }
         return nullptr;
     }
 
-    std::uint8_t* MultiPatternScan(void* module, const std::vector<const char*>& signatures) {
+    std::uint8_t* MultiPatternScan(void* module, std::span<const Scanner::PatternView> signatures) {
         for (const auto& signature : signatures) {
             if (std::uint8_t* result = PatternScan(module, signature)) {
                 return result;
@@ -75,6 +130,37 @@ namespace Memory
         return nullptr;
     }
 
+    // Sampled hash of the module's code sections, identifies the build together with ModuleTimestamp()
+    std::uint64_t CodeHash(void* module)
+    {
+        std::uint64_t hash = 0;
+        for (const auto& [begin, size] : ScanRanges(module, PE::Region::Code)) {
+            hash = hash * 31 + ScanCache::HashCode(begin, size);
+        }
+        return hash;
+    }
+
+    void BatchPatternScan(void* module, Scanner::Batch& batch, PE::Region region = PE::Region::Code) {
+        // One anchored sweep per readable section and unresolved signature in the batch, split across cores for large sections
+        for (const auto& [scanBytes, size] : ScanRanges(module, region)) {
+            batch.Run(scanBytes, size);
+        }
+    }
+
+    std::uint8_t* BatchResult(const Scanner::Batch& batch, const Scanner::PatternView& signature) {
+        return const_cast<std::uint8_t*>(batch.Result(signature));
+    }
+
+    std::uint8_t* BatchResult(const Scanner::Batch& batch, std::span<const Scanner::PatternView> signatures) {
+        // Alternatives are tried in order, same as MultiPatternScan
+        for (const auto& signature : signatures) {
+            if (std::uint8_t* result = BatchResult(batch, signature)) {
+                return result;
+            }
+        }
+        return nullptr;
+    }
+
     static HMODULE GetThisDllHandle()
     {
         MEMORY_BASIC_INFORMATION info;
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Bodies of the mid-hook callbacks and the resolution maths they depend on.
+// Free of Windows and SafetyHook so they can be driven with synthetic contexts and fake stacks (see tools/dafix-bench.cpp).
+// Context is anything with SafetyHook's Context32 register fields, i.e. SafetyHookContext in the DLL.
+// Each callback is specialized on the game and on what the current resolution needs, and every published snapshot carries
+// the specializations selected for it, so the hooks never test options or resolution state per call.
+namespace Hooks
+{
+    constexpr float kPi = 3.1415926535f;
+    constexpr float kNativeAspect = 1.777777791f;
+
+    enum class Variant : std::uint8_t {
+        DA1,
+        DA2
+    };
+
+    struct Resolution;
+
+    // A hook callback with its context type erased, so a snapshot can carry the ones selected for it
+    using Callback = void (*)(void* ctx, const Resolution& resolution);
+
+    // Selected when there is nothing for a hook to do at this resolution
+    inline void Skip(void*, const Resolution&) {}
+
+    struct Callbacks
+    {
+        Callback dialogFOV = Skip;
+        Callback shadowAspectRatio = Skip;
+        Callback pillarboxing = Skip;
+        Callback hudScale = Skip;
+    };
+
+    // Everything the hooks derive from the current resolution, computed once per resolution change
+    struct Resolution
+    {
+        int width = 0;
+        int height = 0;
+        float aspectRatio = 0.00f;
+        float aspectMultiplier = 0.00f;
+        float hudWidth = 0.00f;
+        float hudHeight = 0.00f;
+        float hudWidthOffset = 0.00f;
+        float hudHeightOffset = 0.00f;
+
+        bool bWiderThanNative = false;  // Gates the FOV and shadow aspect fixes
+        float fovScale = 1.00f;         // tan(half vertical FOV) multiplier, aspectRatio / native
+        float hudScale = 0.00f;         // Custom or automatic HUD scale, 0 leaves the game's value alone
+
+        Callbacks callbacks;            // Specializations for this snapshot, see Select()
+    };
+
+    // hudScale is the configured scale, 0 for automatic
+    inline Resolution CalculateResolution(int width, int height, float hudScale = 0.00f)
+    {
+        Resolution resolution;
+        resolution.width = width;
+        resolution.height = height;
+        if (width <= 0 || height <= 0)
+            return resolution;
+
+        // Aspect ratio
+        resolution.aspectRatio = (float)width / (float)height;
+        resolution.aspectMultiplier = resolution.aspectRatio / kNativeAspect;
+
+        // HUD
+        resolution.hudWidth = (float)height * kNativeAspect;
+        resolution.hudHeight = (float)height;
+        resolution.hudWidthOffset = (float)(width - resolution.hudWidth) / 2.00f;
+        resolution.hudHeightOffset = 0.00f;
+        if (resolution.aspectRatio < kNativeAspect) {
+            resolution.hudWidth = (float)width;
+            resolution.hudHeight = (float)width / kNativeAspect;
+            resolution.hudWidthOffset = 0.00f;
+            resolution.hudHeightOffset = (float)(height - resolution.hudHeight) / 2.00f;
+        }
+
+        // Hook constants
+        resolution.bWiderThanNative = resolution.aspectRatio > kNativeAspect;
+        resolution.fovScale = resolution.aspectMultiplier;
+        if (hudScale != 0.00f) {
+            // Custom HUD scale
+            resolution.hudScale = hudScale;
+        }
+        else if (resolution.aspectRatio > 1.333333f && height > 768) {
+            // Automatic HUD scale, keep the HUD at its 1024x768 size
+            resolution.hudScale = 768.00f / (float)height;
+        }
+        else if (resolution.aspectRatio <= 1.33333f && width > 1024) {
+            resolution.hudScale = 1024.00f / (float)width;
+        }
+        return resolution;
+    }
+
+    // Publishes immutable Resolution snapshots to the hooks, RCU style.
+    // The resolution hook builds a new snapshot and swaps the pointer, render thread hooks do a single acquire load and
+    // always see one complete snapshot instead of a mix of old and new globals.
+    // Replaced snapshots are never freed since a hook may still be reading one, resolution changes are rare enough for that.
+    class ResolutionState
+    {
+    public:
+        ResolutionState() : current(&initial) {}
+
+        ResolutionState(const ResolutionState&) = delete;
+        ResolutionState& operator=(const ResolutionState&) = delete;
+
+        const Resolution& Load() const { return *current.load(std::memory_order_acquire); }
+
+        // Generated stubs (see stubs.hpp) load the pointer straight from here, a plain aligned load is an acquire load on x86
+        const void* Address() const { return &current; }
+
+        const Resolution& Publish(const Resolution& resolution)
+        {
+            std::lock_guard lock(writer);
+            snapshots.push_back(std::make_unique<const Resolution>(resolution));
+            current.store(snapshots.back().get(), std::memory_order_release);
+            return *snapshots.back();
+        }
+
+    private:
+        const Resolution initial = {};
+        std::atomic<const Resolution*> current;
+        std::mutex writer;
+        std::vector<std::unique_ptr<const Resolution>> snapshots;
+    };
+
+    // DA1/DA2: Current resolution in eax x ecx, true when it differs from the published one and needs a new snapshot
+    template<typename Context>
+    bool ResolutionChanged(const Context& ctx, const Resolution& resolution)
+    {
+        return static_cast<int>(ctx.eax) != resolution.width || static_cast<int>(ctx.ecx) != resolution.height;
+    }
+
+    // DA1/DA2: Dialog FOV, widen vertical FOV at esp+0xC to keep the native horizontal FOV. Selected when wider than native.
+    template<typename Context>
+    void DialogFOV(void* context, const Resolution& resolution)
+    {
+        auto& ctx = *static_cast<Context*>(context);
+
+        // Dialog cameras pass the same FOV call after call, so remember the last conversion per thread.
+        // Snapshots are never freed, so the pointer identifies the resolution it was computed for.
+        thread_local const Resolution* lastResolution = nullptr;
+        thread_local float lastIn = 0.00f;
+        thread_local float lastOut = 0.00f;
+
+        float& fov = *reinterpret_cast<float*>(ctx.esp + 0xC);
+        if (lastResolution != &resolution || lastIn != fov) {
+            lastResolution = &resolution;
+            lastIn = fov;
+            lastOut = atanf(tanf(fov * (kPi / 360)) * resolution.fovScale) * (360 / kPi);
+        }
+        fov = lastOut;
+    }
+
+    // DA1: Shadow aspect ratio at esp+0xC. Selected when wider than native.
+    template<typename Context>
+    void ShadowAspectRatio(void* context, const Resolution&)
+    {
+        auto& ctx = *static_cast<Context*>(context);
+        *reinterpret_cast<float*>(ctx.esp + 0xC) = kNativeAspect;
+    }
+
+    // DA1: Dialog pillarboxing viewport on the stack, DA2: in registers
+    template<typename Context, Variant V>
+    void Pillarboxing(void* context, const Resolution& resolution)
+    {
+        auto& ctx = *static_cast<Context*>(context);
+        if constexpr (V == Variant::DA1) {
+            *reinterpret_cast<int*>(ctx.esp + 0x0) = 0;                 // Left
+            *reinterpret_cast<int*>(ctx.esp + 0x4) = 0;                 // Right
+            *reinterpret_cast<int*>(ctx.esp + 0x8) = resolution.width;  // Width
+            *reinterpret_cast<int*>(ctx.esp + 0xC) = resolution.height; // Height
+        }
+        else {
+            ctx.ebx = 0;                    // Left
+            ctx.ebp = 0;                    // Right
+            ctx.ecx = resolution.width;     // Width
+            ctx.edx = resolution.height;    // Height
+        }
+    }
+
+    // DA1: HUD scale at esp+0x8. Selected when there is a scale to apply.
+    template<typename Context>
+    void HUDScale(void* context, const Resolution& resolution)
+    {
+        auto& ctx = *static_cast<Context*>(context);
+        *reinterpret_cast<float*>(ctx.esp + 0x08) = resolution.hudScale;
+    }
+
+    // Specializations for a snapshot, picked once when it is published instead of re-tested on every call.
+    // ctx.esp is the game's stack pointer at the hook and never null, so the callbacks don't test it either.
+    template<typename Context>
+    Callbacks Select(Variant variant, const Resolution& resolution)
+    {
+        Callbacks callbacks;
+        if (resolution.bWiderThanNative) {
+            callbacks.dialogFOV = DialogFOV<Context>;
+            callbacks.shadowAspectRatio = ShadowAspectRatio<Context>;
+        }
+        callbacks.pillarboxing = variant == Variant::DA1 ? Pillarboxing<Context, Variant::DA1> : Pillarboxing<Context, Variant::DA2>;
+        if (resolution.hudScale != 0.00f)
+            callbacks.hudScale = HUDScale<Context>;
+        return callbacks;
+    }
+
+    // Calls the specialization the snapshot was published with: one indirect call, no option or state tests
+    template<typename Context>
+    void Call(Callback Callbacks::*callback, Context& ctx, const Resolution& resolution)
+    {
+        (resolution.callbacks.*callback)(&ctx, resolution);
+    }
+}
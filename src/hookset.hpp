@@ -0,0 +1,95 @@
+#pragma once
+
+#include "arena.hpp"
+#include "stubs.hpp"
+
+#include <safetyhook.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Every DAFix hook as one set. Generated stubs are packed into an Arena reserved next to the game's module.
+// SafetyHook's own trampolines and mid-hook stubs can't be placed by us, its Allocator is final and maps its own pages,
+// so they come from an allocator shared by the set only (first fit, so packed back to back).
+// Hooks are created from Patch::Transaction steps, which run one at a time. They stay installed until the process exits,
+// so a set that has installed hooks must never be destroyed: the arena and the allocator would be freed under them.
+class HookSet
+{
+public:
+    // A stub placed in the arena
+    struct Entry
+    {
+        std::string name;
+        const std::uint8_t* target = nullptr;
+        const std::uint8_t* code = nullptr;     // Start of the stub in the arena
+        std::size_t size = 0;
+    };
+
+    // The module [base, base + size) stubs must reach. The arena is reserved within rel32 reach of it by the first Stub().
+    void Near(const std::uint8_t* base, std::size_t size, std::size_t capacity = 0x10000)
+    {
+        module = { base, size, capacity };
+    }
+
+    // A stub needed the arena but it couldn't be placed near the module
+    bool ArenaFailed() const { return bReserveTried && !arena; }
+
+    bool Mid(safetyhook::MidHook& hook, std::uint8_t* target, safetyhook::MidHookFn destination)
+    {
+        auto result = safetyhook::MidHook::create(allocator, target, destination);
+        if (!result)
+            return false;
+        hook = std::move(*result);
+        return true;
+    }
+
+    bool Stub(std::string name, Stubs::Hook& hook, std::uint8_t* target, std::span<const Stubs::Store> stores, const void* state)
+    {
+        std::size_t size = Stubs::Hook::CodeSize(stores);
+        if (!size)
+            return false;
+        if (!bReserveTried && module.base) {
+            bReserveTried = true;
+            arena.Reserve(module.base, module.base + module.size, module.capacity);
+        }
+        std::uint8_t* code = arena.Allocate(name, size);
+        bool bArena = code != nullptr;
+        if (!bArena) {
+            // No arena or it's full: the set's allocator still keeps the stub near its siblings
+            auto allocation = allocator->allocate_near({ target }, size);
+            if (!allocation)
+                return false;
+            code = allocation->data();
+            spill.push_back(std::move(*allocation));
+        }
+
+        if (!hook.Create(target, stores, state, code, allocator))
+            return false;
+        if (bArena)
+            entries.push_back({ std::move(name), target, code, size });
+        return true;
+    }
+
+    const std::vector<Entry>& Entries() const { return entries; }
+    const Arena::Arena<Arena::Pages::Native>& CodeArena() const { return arena; }
+
+private:
+    struct Module
+    {
+        const std::uint8_t* base = nullptr;
+        std::size_t size = 0;
+        std::size_t capacity = 0;
+    };
+
+    Module module;
+    bool bReserveTried = false;
+    Arena::Arena<Arena::Pages::Native> arena;
+    std::shared_ptr<safetyhook::Allocator> allocator = safetyhook::Allocator::create();
+    std::vector<safetyhook::Allocation> spill;
+    std::vector<Entry> entries;
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+// Per-hook call counts and latency histograms.
+// Compiled in only when DAFIX_HOOK_STATS is defined, otherwise HOOK_STATS_SCOPE() expands to nothing.
+// The aggregation core below is platform-neutral so it can be driven with synthetic calls outside the game.
+namespace HookStats
+{
+    constexpr std::size_t kMaxHooks = 32;
+    constexpr std::size_t kMaxThreads = 16;    // Threads past this share the last slot
+    constexpr std::size_t kBuckets = 48;        // log2 buckets of latency in ticks
+
+    // Cheapest available timestamp. Ticks are converted to ns at summary time, see Registry::Collect().
+    inline std::uint64_t Ticks()
+    {
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // Bucket b holds [2^b, 2^(b+1)) ticks
+    inline std::size_t Bucket(std::uint64_t ticks)
+    {
+        std::size_t bucket = ticks ? std::bit_width(ticks) - 1 : 0;
+        return bucket < kBuckets ? bucket : kBuckets - 1;
+    }
+
+    // One thread's counters for one hook, padded so threads never share a cache line
+    struct alignas(64) Counters
+    {
+        std::atomic<std::uint64_t> calls = 0;
+        std::atomic<std::uint64_t> ticks = 0;
+        std::array<std::atomic<std::uint64_t>, kBuckets> histogram = {};
+    };
+
+    inline std::size_t ThreadSlot()
+    {
+        static std::atomic<std::size_t> nextSlot = 0;
+        thread_local std::size_t slot = [] {
+            std::size_t claimed = nextSlot.fetch_add(1, std::memory_order_relaxed);
+            return claimed < kMaxThreads ? claimed : kMaxThreads - 1;
+        }();
+        return slot;
+    }
+
+    class Hook
+    {
+    public:
+        void Record(std::uint64_t ticks)
+        {
+            auto& counters = perThread[ThreadSlot()];
+            counters.calls.fetch_add(1, std::memory_order_relaxed);
+            counters.ticks.fetch_add(ticks, std::memory_order_relaxed);
+            counters.histogram[Bucket(ticks)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const char* Name() const { return name; }
+
+    private:
+        friend class Registry;
+
+        const char* name = nullptr;
+        std::array<Counters, kMaxThreads> perThread = {};
+    };
+
+    // Times the enclosing scope into hook
+    class Scope
+    {
+    public:
+        explicit Scope(Hook& hook) : hook(hook), start(Ticks()) {}
+        ~Scope() { hook.Record(Ticks() - start); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Hook& hook;
+        std::uint64_t start;
+    };
+
+    struct Summary
+    {
+        const char* name = nullptr;
+        std::uint64_t calls = 0;        // Since the previous Collect()
+        double callsPerSec = 0.0;
+        double meanNs = 0.0;
+        double p50Ns = 0.0;             // Upper bound of the bucket holding the percentile
+        double p99Ns = 0.0;
+        std::uint64_t totalCalls = 0;
+    };
+
+    class Registry
+    {
+    public:
+        Registry() : startTicks(Ticks()), startTime(std::chrono::steady_clock::now()), lastTime(startTime) {}
+
+        static Registry& Global()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        // Returns the same Hook for the same name. Hooks live as long as the registry, so references stay valid.
+        Hook& Register(const char* name)
+        {
+            std::lock_guard lock(mutex);
+            for (std::size_t i = 0; i < count; ++i) {
+                if (std::string(hooks[i].name) == name)
+                    return hooks[i];
+            }
+            // Out of slots: fold the rest into the last hook rather than fail on the render path
+            Hook& hook = hooks[count < kMaxHooks ? count++ : kMaxHooks - 1];
+            if (!hook.name)
+                hook.name = name;
+            return hook;
+        }
+
+        // Merge every thread's counters, lock-free against writers.
+        // Rates and percentiles cover the interval since the previous call, now is injectable for tests.
+        std::vector<Summary> Collect(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now())
+        {
+            std::lock_guard lock(mutex);
+
+            // Calibrate ticks against the steady clock over the registry's lifetime
+            std::uint64_t elapsedTicks = Ticks() - startTicks;
+            double elapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+            double nsPerTick = elapsedTicks && elapsedNs > 0.0 ? elapsedNs / elapsedTicks : 1.0;
+            double intervalSec = std::chrono::duration<double>(now - lastTime).count();
+            lastTime = now;
+
+            std::vector<Summary> summaries;
+            for (std::size_t i = 0; i < count; ++i) {
+                Totals totals;
+                for (const auto& counters : hooks[i].perThread) {
+                    totals.calls += counters.calls.load(std::memory_order_relaxed);
+                    totals.ticks += counters.ticks.load(std::memory_order_relaxed);
+                    for (std::size_t bucket = 0; bucket < kBuckets; ++bucket)
+                        totals.histogram[bucket] += counters.histogram[bucket].load(std::memory_order_relaxed);
+                }
+
+                // Interval = totals - what the previous summary saw
+                Totals interval = totals;
+                interval.calls -= previous[i].calls;
+                interval.ticks -= previous[i].ticks;
+                for (std::size_t bucket = 0; bucket < kBuckets; ++bucket)
+                    interval.histogram[bucket] -= previous[i].histogram[bucket];
+                previous[i] = totals;
+
+                Summary summary;
+                summary.name = hooks[i].name;
+                summary.calls = interval.calls;
+                summary.totalCalls = totals.calls;
+                summary.callsPerSec = intervalSec > 0.0 ? interval.calls / intervalSec : 0.0;
+                if (interval.calls) {
+                    summary.meanNs = interval.ticks * nsPerTick / interval.calls;
+                    summary.p50Ns = Percentile(interval, 0.50) * nsPerTick;
+                    summary.p99Ns = Percentile(interval, 0.99) * nsPerTick;
+                }
+                summaries.push_back(summary);
+            }
+            return summaries;
+        }
+
+    private:
+        struct Totals
+        {
+            std::uint64_t calls = 0;
+            std::uint64_t ticks = 0;
+            std::array<std::uint64_t, kBuckets> histogram = {};
+        };
+
+        static double Percentile(const Totals& totals, double fraction)
+        {
+            std::uint64_t target = static_cast<std::uint64_t>(totals.calls * fraction);
+            std::uint64_t seen = 0;
+            for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+                seen += totals.histogram[bucket];
+                if (seen > target)
+                    return static_cast<double>(std::uint64_t(2) << bucket);
+            }
+            return static_cast<double>(std::uint64_t(2) << (kBuckets - 1));
+        }
+
+        std::mutex mutex;
+        std::array<Hook, kMaxHooks> hooks = {};
+        std::array<Totals, kMaxHooks> previous = {};
+        std::size_t count = 0;
+        std::uint64_t startTicks;
+        std::chrono::steady_clock::time_point startTime;
+        std::chrono::steady_clock::time_point lastTime;
+    };
+}
+
+#if defined(DAFIX_HOOK_STATS)
+// Time the rest of the enclosing hook callback under name
+#define HOOK_STATS_SCOPE(name) \
+    static HookStats::Hook& hookStats = HookStats::Registry::Global().Register(name); \
+    HookStats::Scope hookStatsScope(hookStats)
+#else
+#define HOOK_STATS_SCOPE(name) ((void)0)
+#endif
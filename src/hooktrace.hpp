@@ -0,0 +1,306 @@
+#pragma once
+
+#include "asynclog.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Hook context traces. Compiled in only when DAFIX_HOOK_TRACE is defined, otherwise HOOK_TRACE_SCOPE() and
+// HOOK_TRACE_RESOLUTION() expand to nothing. Each traced call records the registers and the stack slots the hooks touch
+// (esp+0x0..0xC) before and after the callback, so a trace can be replayed through the same Hooks:: code and its outputs
+// checked against the game's (see tools/dafix-replay.cpp).
+// File layout: one Header, then fixed-size Records in the order they were drained, little-endian as x86 writes them.
+namespace HookTrace
+{
+    constexpr std::uint32_t kMagic = 0x54464144;    // "DAFT"
+    constexpr std::uint32_t kVersion = 1;
+    constexpr std::size_t kStackSlots = 4;          // esp+0x0, 0x4, 0x8, 0xC
+    constexpr std::size_t kRingSize = 4096;         // Records, power of two
+
+    enum class Site : std::uint16_t {
+        Resolution,                 // Not a hook: a snapshot was published for before.eax x before.ecx
+        CurrentResolution,
+        DA1_ShadowAspectRatio,
+        DA1_Pillarboxing,
+        DA2_Pillarboxing,
+        DialogFOV,
+        DA1_HUDScale,
+        Count
+    };
+
+    inline const char* Name(Site site)
+    {
+        constexpr const char* kNames[] = { "Resolution", "CurrentResolution", "DA1_ShadowAspectRatio", "DA1_Pillarboxing", "DA2_Pillarboxing",
+            "DialogFOV", "DA1_HUDScale" };
+        auto index = static_cast<std::size_t>(site);
+        return index < std::size(kNames) ? kNames[index] : "Unknown";
+    }
+
+    // SafetyHook's Context32 integer registers, same order, truncated to 32 bits
+    struct Registers
+    {
+        std::uint32_t edi = 0;
+        std::uint32_t esi = 0;
+        std::uint32_t edx = 0;
+        std::uint32_t ecx = 0;
+        std::uint32_t ebx = 0;
+        std::uint32_t eax = 0;
+        std::uint32_t ebp = 0;
+        std::uint32_t esp = 0;
+
+        bool operator==(const Registers&) const = default;
+    };
+
+    struct Header
+    {
+        std::uint32_t magic = kMagic;
+        std::uint32_t version = kVersion;
+        std::uint32_t recordSize = 0;
+        std::uint32_t game = 0;         // Signatures::kDA1 / kDA2
+        float hudScale = 0.00f;         // Configured scale the snapshots were calculated with, 0 for automatic
+        std::uint32_t padding = 0;
+        std::int64_t startTime = 0;     // system_clock ns since epoch, Record::time counts from here
+    };
+
+    struct Record
+    {
+        std::uint64_t time = 0;         // ns since Header::startTime
+        Site site = Site::Resolution;
+        std::uint16_t thread = 0;
+        std::uint32_t padding = 0;
+        Registers before;
+        Registers after;
+        std::array<std::uint32_t, kStackSlots> stackBefore = {};    // Only read when esp is set
+        std::array<std::uint32_t, kStackSlots> stackAfter = {};
+    };
+    static_assert(sizeof(Header) == 32 && sizeof(Record) == 112 && std::is_trivially_copyable_v<Record>, "Trace layout changed, bump kVersion");
+
+    template<typename Context>
+    Registers Read(const Context& ctx)
+    {
+        return { static_cast<std::uint32_t>(ctx.edi), static_cast<std::uint32_t>(ctx.esi), static_cast<std::uint32_t>(ctx.edx),
+            static_cast<std::uint32_t>(ctx.ecx), static_cast<std::uint32_t>(ctx.ebx), static_cast<std::uint32_t>(ctx.eax),
+            static_cast<std::uint32_t>(ctx.ebp), static_cast<std::uint32_t>(ctx.esp) };
+    }
+
+    template<typename Context>
+    void ReadStack(const Context& ctx, std::array<std::uint32_t, kStackSlots>& slots)
+    {
+        if (ctx.esp)
+            std::memcpy(slots.data(), reinterpret_cast<const void*>(ctx.esp), sizeof(slots));
+    }
+
+    // Fill in the before half of a record for a call about to run, End() fills in the rest once it has
+    template<typename Context>
+    void Begin(Record& record, Site site, const Context& ctx)
+    {
+        record.site = site;
+        record.before = Read(ctx);
+        ReadStack(ctx, record.stackBefore);
+    }
+
+    template<typename Context>
+    void End(Record& record, const Context& ctx)
+    {
+        record.after = Read(ctx);
+        ReadStack(ctx, record.stackAfter);
+    }
+
+    struct Trace
+    {
+        Header header;
+        std::vector<Record> records;
+    };
+
+    // nullopt if the file can't be read, isn't a trace or was written by another version.
+    // A record cut short by the game exiting mid-write is dropped.
+    inline std::optional<Trace> Load(const std::filesystem::path& path)
+    {
+        std::FILE* file = std::fopen(path.string().c_str(), "rb");
+        if (!file)
+            return std::nullopt;
+        Trace trace;
+        bool bValid = std::fread(&trace.header, sizeof(Header), 1, file) == 1 && trace.header.magic == kMagic &&
+            trace.header.version == kVersion && trace.header.recordSize == sizeof(Record);
+        Record record;
+        while (bValid && std::fread(&record, sizeof(Record), 1, file) == 1)
+            trace.records.push_back(record);
+        std::fclose(file);
+        if (!bValid)
+            return std::nullopt;
+        return trace;
+    }
+
+    inline bool Save(const std::filesystem::path& path, const Trace& trace)
+    {
+        std::FILE* file = std::fopen(path.string().c_str(), "wb");
+        if (!file)
+            return false;
+        Header header = trace.header;
+        header.recordSize = sizeof(Record);
+        bool bWritten = std::fwrite(&header, sizeof(Header), 1, file) == 1 &&
+            std::fwrite(trace.records.data(), sizeof(Record), trace.records.size(), file) == trace.records.size();
+        return std::fclose(file) == 0 && bWritten;
+    }
+
+    // Hooks push records into a lock-free ring, a background thread appends them to the file in batches.
+    // A full ring drops records rather than stall the render thread, drops are counted.
+    class Writer
+    {
+    public:
+        ~Writer() { Stop(); }
+
+        // Never destroyed, hooks may still be traced while the process exits
+        static Writer& Global()
+        {
+            static Writer* writer = new Writer;
+            return *writer;
+        }
+
+        // Truncates path and writes the header, then drains the ring every interval.
+        // Each batch is flushed, so a trace cut off by the game exiting is only missing its last interval.
+        bool Start(const std::filesystem::path& path, std::uint32_t game, float hudScale, std::chrono::milliseconds interval = std::chrono::milliseconds(250))
+        {
+            Stop();
+            file = std::fopen(path.string().c_str(), "wb");
+            if (!file)
+                return false;
+            Header header;
+            header.recordSize = sizeof(Record);
+            header.game = game;
+            header.hudScale = hudScale;
+            header.startTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            start = std::chrono::steady_clock::now();
+            std::fwrite(&header, sizeof(Header), 1, file);
+            std::fflush(file);
+
+            bRunning.store(true, std::memory_order_release);
+            worker = std::thread([this, interval] {
+                while (bRunning.load(std::memory_order_acquire)) {
+                    Drain();
+                    std::this_thread::sleep_for(interval);
+                }
+                Drain();
+            });
+            return true;
+        }
+
+        // Write out everything pushed so far and close the file
+        void Stop()
+        {
+            if (worker.joinable()) {
+                bRunning.store(false, std::memory_order_release);
+                worker.join();
+            }
+            if (file)
+                std::fclose(file);
+            file = nullptr;
+        }
+
+        bool Running() const { return bRunning.load(std::memory_order_acquire); }
+
+        // Any thread. Stamps the record with the time and the calling thread, does nothing until Start().
+        void Push(Record& record)
+        {
+            if (!Running())
+                return;
+            record.time = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            record.thread = ThreadSlot();
+            ring.TryPush(record);
+        }
+
+        void Resolution(int width, int height)
+        {
+            Record record;
+            record.site = Site::Resolution;
+            record.before.eax = static_cast<std::uint32_t>(width);
+            record.before.ecx = static_cast<std::uint32_t>(height);
+            record.after = record.before;
+            Push(record);
+        }
+
+        std::size_t Written() const { return written.load(std::memory_order_relaxed); }
+        std::size_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    private:
+        static std::uint16_t ThreadSlot()
+        {
+            static std::atomic<std::uint16_t> nextSlot = 0;
+            thread_local std::uint16_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+            return slot;
+        }
+
+        void Drain()
+        {
+            batch.clear();
+            Record record;
+            while (ring.TryPop(record))
+                batch.push_back(record);
+            if (!batch.empty() && file) {
+                std::fwrite(batch.data(), sizeof(Record), batch.size(), file);
+                std::fflush(file);
+            }
+            written.fetch_add(batch.size(), std::memory_order_relaxed);
+            dropped.fetch_add(ring.TakeDropped(), std::memory_order_relaxed);
+        }
+
+        AsyncLog::BasicRing<Record, kRingSize> ring;
+        std::FILE* file = nullptr;
+        std::chrono::steady_clock::time_point start;
+        std::atomic<bool> bRunning = false;
+        std::thread worker;
+        std::vector<Record> batch;
+        std::atomic<std::size_t> written = 0;
+        std::atomic<std::size_t> dropped = 0;
+    };
+
+    // Records the enclosing hook callback: context on construction, outputs on destruction
+    template<typename Context>
+    class Scope
+    {
+    public:
+        Scope(Writer& writer, Site site, Context& ctx) : writer(writer), ctx(ctx)
+        {
+            bActive = writer.Running();
+            if (bActive)
+                Begin(record, site, ctx);
+        }
+
+        ~Scope()
+        {
+            if (!bActive)
+                return;
+            End(record, ctx);
+            writer.Push(record);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Writer& writer;
+        Context& ctx;
+        Record record;
+        bool bActive = false;
+    };
+}
+
+#if defined(DAFIX_HOOK_TRACE)
+// Trace the rest of the enclosing hook callback as site, ctx is its SafetyHookContext
+#define HOOK_TRACE_SCOPE(site, ctx) HookTrace::Scope hookTraceScope(HookTrace::Writer::Global(), HookTrace::Site::site, ctx)
+// A new resolution snapshot was published, replays recalculate it at the same point in the trace
+#define HOOK_TRACE_RESOLUTION(width, height) HookTrace::Writer::Global().Resolution(width, height)
+#else
+#define HOOK_TRACE_SCOPE(site, ctx) ((void)0)
+#define HOOK_TRACE_RESOLUTION(width, height) ((void)0)
+#endif
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "scanner.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Incremental rescans while the game's executable unpacks itself. A few cache lines of every page are hashed each attempt
+// and only pages whose samples changed are scanned again, widened by the signature length so matches straddling a changed
+// page are still seen. An unpacker rewrites whole pages, which the samples catch; a change confined to unsampled bytes is
+// left to a full rescan every kFullRescanEvery attempts.
+// Works on plain byte ranges so it can be driven by a simulated unpacker (see tools/dafix-bench.cpp).
+namespace PageWatch
+{
+    constexpr std::size_t kPageSize = 4096;
+    constexpr std::size_t kLineSize = 64;
+    constexpr std::size_t kSamples = 4;             // Lines hashed per page, one in each quarter
+    constexpr int kFullRescanEvery = 5;             // Attempts, the last of every kFullRescanEvery scans everything
+
+    // Offset of a page's sample within it. Which line of each quarter is sampled differs from page to page, so a
+    // change at the same offset of every page isn't missed everywhere.
+    constexpr std::size_t SampleOffset(std::size_t page, std::size_t sample)
+    {
+        constexpr std::size_t linesPerQuarter = kPageSize / kLineSize / kSamples;
+        return (sample * linesPerQuarter + (page * 7 + sample * 5) % linesPerQuarter) * kLineSize;
+    }
+
+    // Hash of a page's samples. A partial page at the end of a range is hashed whole.
+    inline std::uint64_t HashPage(const std::uint8_t* data, std::size_t size, std::size_t page)
+    {
+        std::uint64_t hash = size;
+        auto mix = [&hash](const std::uint8_t* bytes, std::size_t count) {
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                std::uint64_t word;
+                std::memcpy(&word, bytes + i, sizeof(word));
+                hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+            }
+            for (; i < count; ++i)
+                hash = (hash ^ bytes[i]) * 0x9E3779B97F4A7C15ull;
+        };
+        if (size < kPageSize) {
+            mix(data, size);
+            return hash;
+        }
+        for (std::size_t sample = 0; sample < kSamples; ++sample)
+            mix(data + SampleOffset(page, sample), kLineSize);
+        return hash;
+    }
+
+    // Byte offsets into a tracked range
+    struct Span
+    {
+        std::size_t offset = 0;
+        std::size_t size = 0;
+    };
+
+    // Per-page sample hashes of one range
+    class Tracker
+    {
+    public:
+        // Pages of [data, data + size) whose samples changed since the last call, merged into runs.
+        // The first call, or one where the range moved or changed size, returns the whole range.
+        std::vector<Span> Update(const std::uint8_t* data, std::size_t size)
+        {
+            std::vector<Span> changed;
+            std::size_t pages = (size + kPageSize - 1) / kPageSize;
+            bool bReset = data != base || size != length;
+            if (bReset) {
+                base = data;
+                length = size;
+                hashes.assign(pages, 0);
+            }
+
+            for (std::size_t page = 0; page < pages; ++page) {
+                std::size_t offset = page * kPageSize;
+                std::size_t count = std::min(kPageSize, size - offset);
+                std::uint64_t hash = HashPage(data + offset, count, page);
+                if (!bReset && hash == hashes[page])
+                    continue;
+                hashes[page] = hash;
+                if (!changed.empty() && changed.back().offset + changed.back().size == offset)
+                    changed.back().size += count;
+                else
+                    changed.push_back({ offset, count });
+            }
+            return changed;
+        }
+
+        std::size_t Pages() const { return hashes.size(); }
+
+    private:
+        const std::uint8_t* base = nullptr;
+        std::size_t length = 0;
+        std::vector<std::uint64_t> hashes;
+    };
+
+    // Search windows covering every match start that overlaps a changed span: each span widened by margin bytes on both sides
+    // (margin = pattern length - 1), clipped to size, overlapping windows merged
+    inline std::vector<Span> Widen(const std::vector<Span>& spans, std::size_t margin, std::size_t size)
+    {
+        std::vector<Span> windows;
+        for (const auto& span : spans) {
+            std::size_t begin = span.offset > margin ? span.offset - margin : 0;
+            std::size_t end = std::min(span.offset + span.size + margin, size);
+            if (!windows.empty() && begin <= windows.back().offset + windows.back().size)
+                windows.back().size = std::max(windows.back().offset + windows.back().size, end) - windows.back().offset;
+            else
+                windows.push_back({ begin, end - begin });
+        }
+        return windows;
+    }
+
+    // Lowest match of pattern overlapping a changed span. When every earlier attempt came up empty and the samples saw
+    // every change since, a match can only overlap changed pages, so this equals a full Find() over [data, data + size).
+    inline const std::uint8_t* Rescan(const std::uint8_t* data, std::size_t size, const std::vector<Span>& changed, const Scanner::PatternView& pattern)
+    {
+        if (pattern.length == 0)
+            return nullptr;
+        for (const auto& window : Widen(changed, pattern.length - 1, size)) {
+            if (auto result = Scanner::Find(data + window.offset, window.size, pattern))
+                return result;
+        }
+        return nullptr;
+    }
+
+    // Whether attempt (1-based) scans everything instead of only the changed pages
+    constexpr bool FullRescan(int attempt) { return attempt % kFullRescanEvery == 0; }
+}
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <tlhelp32.h>
+#else
+#include <cstdio>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Batched memory patches.
+// A Transaction collects writes and install steps (hooks) in groups, one per feature, then commits them with one protection
+// change per touched page. A failing step or page rolls back only the groups it belongs to. Page protection goes through a platform layer so the grouping and
+// rollback logic runs the same against VirtualProtect in the game and mprotect on Linux (see tools/dafix-bench.cpp).
+namespace Patch
+{
+    namespace Protect
+    {
+#if defined(_WIN32)
+        struct Win32
+        {
+            static std::size_t PageSize()
+            {
+                static const std::size_t pageSize = [] {
+                    SYSTEM_INFO info;
+                    GetSystemInfo(&info);
+                    return static_cast<std::size_t>(info.dwPageSize);
+                }();
+                return pageSize;
+            }
+
+            // Makes one page writable, old receives the protection to restore
+            static bool Unprotect(std::uint8_t* page, std::uint32_t& old)
+            {
+                DWORD oldProtect = 0;
+                if (!VirtualProtect(page, PageSize(), PAGE_EXECUTE_READWRITE, &oldProtect))
+                    return false;
+                old = oldProtect;
+                return true;
+            }
+
+            static bool Restore(std::uint8_t* page, std::uint32_t old)
+            {
+                DWORD oldProtect = 0;
+                return VirtualProtect(page, PageSize(), old, &oldProtect) != FALSE;
+            }
+
+            static void FlushCode(std::uint8_t* address, std::size_t size)
+            {
+                FlushInstructionCache(GetCurrentProcess(), address, size);
+            }
+
+            // Suspends every other thread of the process for its lifetime.
+            // Nothing may allocate while frozen, a suspended thread could be holding the heap lock.
+            class Freeze
+            {
+            public:
+                Freeze()
+                {
+                    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+                    if (snapshot == INVALID_HANDLE_VALUE)
+                        return;
+
+                    DWORD processId = GetCurrentProcessId();
+                    DWORD threadId = GetCurrentThreadId();
+                    std::vector<DWORD> threadIds;
+                    THREADENTRY32 entry = {};
+                    entry.dwSize = sizeof(entry);
+                    for (BOOL ok = Thread32First(snapshot, &entry); ok; ok = Thread32Next(snapshot, &entry)) {
+                        if (entry.th32OwnerProcessID == processId && entry.th32ThreadID != threadId)
+                            threadIds.push_back(entry.th32ThreadID);
+                    }
+                    CloseHandle(snapshot);
+
+                    // Reserve before the first suspend
+                    threads.reserve(threadIds.size());
+                    for (DWORD id : threadIds) {
+                        HANDLE thread = OpenThread(THREAD_SUSPEND_RESUME, FALSE, id);
+                        if (!thread)
+                            continue;
+                        if (SuspendThread(thread) == static_cast<DWORD>(-1)) {
+                            CloseHandle(thread);
+                            continue;
+                        }
+                        threads.push_back(thread);
+                    }
+                }
+
+                ~Freeze()
+                {
+                    for (HANDLE thread : threads) {
+                        ResumeThread(thread);
+                        CloseHandle(thread);
+                    }
+                }
+
+                Freeze(const Freeze&) = delete;
+                Freeze& operator=(const Freeze&) = delete;
+
+            private:
+                std::vector<HANDLE> threads;
+            };
+        };
+
+        using Native = Win32;
+#else
+        struct Posix
+        {
+            static std::size_t PageSize()
+            {
+                static const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+                return pageSize;
+            }
+
+            // mprotect can't report the previous protection, so read it from /proc/self/maps
+            static bool Query(std::uint8_t* page, std::uint32_t& protection)
+            {
+                std::FILE* maps = std::fopen("/proc/self/maps", "r");
+                if (!maps)
+                    return false;
+
+                bool bFound = false;
+                unsigned long long begin = 0;
+                unsigned long long end = 0;
+                char flags[5] = {};
+                char line[512];
+                auto address = reinterpret_cast<std::uintptr_t>(page);
+                while (!bFound && std::fgets(line, sizeof(line), maps)) {
+                    if (std::sscanf(line, "%llx-%llx %4s", &begin, &end, flags) != 3)
+                        continue;
+                    if (address >= begin && address < end) {
+                        protection = (flags[0] == 'r' ? PROT_READ : 0) | (flags[1] == 'w' ? PROT_WRITE : 0) | (flags[2] == 'x' ? PROT_EXEC : 0);
+                        bFound = true;
+                    }
+                }
+                std::fclose(maps);
+                return bFound;
+            }
+
+            static bool Unprotect(std::uint8_t* page, std::uint32_t& old)
+            {
+                if (!Query(page, old))
+                    return false;
+                return mprotect(page, PageSize(), PROT_READ | PROT_WRITE | PROT_EXEC) == 0;
+            }
+
+            static bool Restore(std::uint8_t* page, std::uint32_t old)
+            {
+                return mprotect(page, PageSize(), static_cast<int>(old)) == 0;
+            }
+
+            static void FlushCode(std::uint8_t* address, std::size_t size)
+            {
+                __builtin___clear_cache(reinterpret_cast<char*>(address), reinterpret_cast<char*>(address + size));
+            }
+
+            // There is no portable way to suspend other threads, Linux only runs the tools and tests
+            struct Freeze
+            {
+            };
+        };
+
+        using Native = Posix;
+#endif
+    }
+
+    // Platform provides PageSize(), Unprotect(page, old), Restore(page, old), FlushCode(address, size) and a Freeze RAII type
+    template<typename Platform>
+    class Transaction
+    {
+    public:
+        Transaction() = default;
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+
+        template<typename T>
+        void Write(std::uint8_t* address, T value)
+        {
+            Bytes(address, reinterpret_cast<const std::uint8_t*>(&value), sizeof(T));
+        }
+
+        void Bytes(std::uint8_t* address, const void* data, std::size_t size)
+        {
+            const auto* bytes = static_cast<const std::uint8_t*>(data);
+            writes.push_back({ address, buffer.size(), size, group });
+            buffer.insert(buffer.end(), bytes, bytes + size);
+        }
+
+        // Install steps run in order before the writes, undo runs in reverse order if a later step or write of the same group fails
+        void Step(std::function<bool()> apply, std::function<void()> undo)
+        {
+            steps.push_back({ std::move(apply), std::move(undo), group });
+        }
+
+        // Starts a new group and returns its index, later writes and steps belong to it. Anything queued before the first
+        // call is group 0.
+        std::size_t Group() { return ++group; }
+
+        std::size_t Groups() const { return group + 1; }
+        std::size_t Writes() const { return writes.size(); }
+        std::size_t Steps() const { return steps.size(); }
+
+        // Distinct pages the writes touch, i.e. protection changes per direction on commit
+        std::size_t Pages() const { return CollectPages(std::vector<bool>(Groups(), true)).size(); }
+
+        // Applies every group whose steps and pages all succeed and rolls back the rest, returns whether each group applied.
+        // The transaction is empty afterwards.
+        std::vector<bool> Commit()
+        {
+            std::vector<bool> applied(Groups(), true);
+            Apply(applied);
+            writes.clear();
+            buffer.clear();
+            steps.clear();
+            group = 0;
+            return applied;
+        }
+
+    private:
+        struct Pending
+        {
+            std::uint8_t* address;
+            std::size_t offset;     // Into buffer
+            std::size_t size;
+            std::size_t group;
+        };
+
+        struct Install
+        {
+            std::function<bool()> apply;
+            std::function<void()> undo;
+            std::size_t group;
+        };
+
+        struct Page
+        {
+            std::uint8_t* address;
+            std::uint32_t protection;
+        };
+
+        static std::uintptr_t PageOf(const std::uint8_t* address)
+        {
+            return reinterpret_cast<std::uintptr_t>(address) & ~(static_cast<std::uintptr_t>(Platform::PageSize()) - 1);
+        }
+
+        // Pages touched by the writes of applied groups, sorted and distinct
+        std::vector<Page> CollectPages(const std::vector<bool>& applied) const
+        {
+            const std::uintptr_t pageSize = Platform::PageSize();
+            std::vector<Page> pages;
+            for (const auto& write : writes) {
+                if (!write.size || !applied[write.group])
+                    continue;
+                for (std::uintptr_t page = PageOf(write.address); page <= PageOf(write.address + write.size - 1); page += pageSize)
+                    pages.push_back({ reinterpret_cast<std::uint8_t*>(page), 0 });
+            }
+            std::sort(pages.begin(), pages.end(), [](const Page& a, const Page& b) { return a.address < b.address; });
+            pages.erase(std::unique(pages.begin(), pages.end(), [](const Page& a, const Page& b) { return a.address == b.address; }), pages.end());
+            return pages;
+        }
+
+        // Fails every group with a write on page
+        void FailPage(const Page& page, std::vector<bool>& applied) const
+        {
+            auto address = reinterpret_cast<std::uintptr_t>(page.address);
+            for (const auto& write : writes) {
+                if (write.size && PageOf(write.address) <= address && address <= PageOf(write.address + write.size - 1))
+                    applied[write.group] = false;
+            }
+        }
+
+        void Apply(std::vector<bool>& applied)
+        {
+            // Hooks first. SafetyHook allocates and freezes threads itself for each one, so they can't run under our freeze.
+            // A failing step only stops the rest of its group.
+            std::vector<std::size_t> done;
+            for (std::size_t i = 0; i < steps.size(); ++i) {
+                if (!applied[steps[i].group])
+                    continue;
+                if (steps[i].apply())
+                    done.push_back(i);
+                else
+                    applied[steps[i].group] = false;
+            }
+
+            std::vector<Page> pages = CollectPages(applied);
+            std::vector<Page> unprotected;
+            for (auto& page : pages) {
+                if (Platform::Unprotect(page.address, page.protection))
+                    unprotected.push_back(page);
+                else
+                    FailPage(page, applied);
+            }
+
+            // Undo the steps of failed groups, newest first
+            for (auto i = done.rbegin(); i != done.rend(); ++i) {
+                if (!applied[steps[*i].group])
+                    steps[*i].undo();
+            }
+
+            // Every page an applied group writes to is writable now, so nothing below can fail. Write everything in one freeze.
+            {
+                [[maybe_unused]] typename Platform::Freeze freeze;
+                for (const auto& write : writes) {
+                    if (applied[write.group])
+                        std::memcpy(write.address, buffer.data() + write.offset, write.size);
+                }
+            }
+
+            for (const auto& write : writes) {
+                if (applied[write.group])
+                    Platform::FlushCode(write.address, write.size);
+            }
+            for (const auto& page : unprotected)
+                Platform::Restore(page.address, page.protection);
+        }
+
+        std::vector<Pending> writes;
+        std::vector<std::uint8_t> buffer;
+        std::vector<Install> steps;
+        std::size_t group = 0;
+    };
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Minimal PE layout parser over a raw byte buffer. No Windows headers, so it works on a mapped module or a file read from disk.
+namespace PE
+{
+    constexpr std::uint32_t kScnCntCode = 0x00000020;
+    constexpr std::uint32_t kScnCntInitializedData = 0x00000040;
+    constexpr std::uint32_t kScnCntUninitializedData = 0x00000080;
+    constexpr std::uint32_t kScnMemExecute = 0x20000000;
+    constexpr std::uint32_t kScnMemRead = 0x40000000;
+    constexpr std::uint32_t kScnMemWrite = 0x80000000;
+
+    enum class Region {
+        Code,   // Executable sections
+        Data,   // Initialised, non-executable data (.rdata/.data), excluding resources and relocations
+        All     // Whole image
+    };
+
+    struct Range
+    {
+        std::uint32_t offset;   // RVA for image ranges, file offset for file ranges
+        std::uint32_t size;
+    };
+
+    struct Section
+    {
+        std::string name;
+        std::uint32_t virtualAddress = 0;
+        std::uint32_t virtualSize = 0;
+        std::uint32_t rawOffset = 0;
+        std::uint32_t rawSize = 0;
+        std::uint32_t characteristics = 0;
+
+        bool IsExecutable() const { return (characteristics & (kScnMemExecute | kScnCntCode)) != 0; }
+        bool IsReadable() const { return (characteristics & kScnMemRead) != 0; }
+        bool IsWritable() const { return (characteristics & kScnMemWrite) != 0; }
+
+        bool IsData() const
+        {
+            if (IsExecutable() || !(characteristics & kScnCntInitializedData))
+                return false;
+            return name != ".rsrc" && name != ".reloc";
+        }
+
+        bool In(Region region) const
+        {
+            switch (region) {
+            case Region::Code: return IsExecutable();
+            case Region::Data: return IsData();
+            default: return true;
+            }
+        }
+
+        // Size once mapped, some linkers leave VirtualSize as 0
+        std::uint32_t MappedSize() const { return virtualSize ? virtualSize : rawSize; }
+    };
+
+    struct Layout
+    {
+        std::uint16_t machine = 0;
+        std::uint32_t timestamp = 0;
+        std::uint64_t imageBase = 0;
+        std::uint32_t sizeOfImage = 0;
+        std::uint32_t sizeOfHeaders = 0;
+        std::vector<Section> sections;
+
+        const Section* FindSection(const std::string& name) const
+        {
+            for (const auto& section : sections) {
+                if (section.name == name)
+                    return &section;
+            }
+            return nullptr;
+        }
+
+        const Section* SectionFromRva(std::uint32_t rva) const
+        {
+            for (const auto& section : sections) {
+                if (rva >= section.virtualAddress && rva - section.virtualAddress < section.MappedSize())
+                    return &section;
+            }
+            return nullptr;
+        }
+
+        std::optional<std::uint32_t> RvaToOffset(std::uint32_t rva) const
+        {
+            if (rva < sizeOfHeaders)
+                return rva;
+            const Section* section = SectionFromRva(rva);
+            if (!section || rva - section->virtualAddress >= section->rawSize)
+                return std::nullopt;
+            return section->rawOffset + (rva - section->virtualAddress);
+        }
+
+        std::optional<std::uint32_t> OffsetToRva(std::uint32_t offset) const
+        {
+            if (offset < sizeOfHeaders)
+                return offset;
+            for (const auto& section : sections) {
+                if (offset >= section.rawOffset && offset - section.rawOffset < section.rawSize) {
+                    std::uint32_t delta = offset - section.rawOffset;
+                    if (delta >= section.MappedSize())
+                        return std::nullopt;
+                    return section.virtualAddress + delta;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // RVA ranges of a loaded image covering region
+        std::vector<Range> ImageRanges(Region region) const
+        {
+            if (region == Region::All)
+                return { { 0, sizeOfImage } };
+
+            std::vector<Range> ranges;
+            for (const auto& section : sections) {
+                if (!section.In(region) || section.virtualAddress >= sizeOfImage)
+                    continue;
+                std::uint32_t size = section.MappedSize();
+                if (size > sizeOfImage - section.virtualAddress)
+                    size = sizeOfImage - section.virtualAddress;
+                ranges.push_back({ section.virtualAddress, size });
+            }
+            return Merge(std::move(ranges));
+        }
+
+        // File offset ranges of an on-disk image covering region, clipped to fileSize
+        std::vector<Range> FileRanges(Region region, std::size_t fileSize) const
+        {
+            std::vector<Range> ranges;
+            if (region == Region::All) {
+                ranges.push_back({ 0, static_cast<std::uint32_t>(fileSize) });
+                return ranges;
+            }
+            for (const auto& section : sections) {
+                if (!section.In(region) || section.rawOffset >= fileSize)
+                    continue;
+                std::uint32_t size = section.rawSize;
+                if (section.virtualSize && section.virtualSize < size)
+                    size = section.virtualSize;
+                if (size > fileSize - section.rawOffset)
+                    size = static_cast<std::uint32_t>(fileSize - section.rawOffset);
+                ranges.push_back({ section.rawOffset, size });
+            }
+            // Not merged: sections adjacent on disk need not be adjacent once mapped
+            std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.offset < b.offset; });
+            return ranges;
+        }
+
+    private:
+        // Order by address and merge neighbours so a scan can cross adjacent sections
+        static std::vector<Range> Merge(std::vector<Range> ranges)
+        {
+            std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.offset < b.offset; });
+            std::vector<Range> merged;
+            for (const auto& range : ranges) {
+                if (!merged.empty() && range.offset <= merged.back().offset + merged.back().size) {
+                    std::uint32_t end = range.offset + range.size;
+                    if (end > merged.back().offset + merged.back().size)
+                        merged.back().size = end - merged.back().offset;
+                }
+                else if (range.size) {
+                    merged.push_back(range);
+                }
+            }
+            return merged;
+        }
+    };
+
+    namespace Detail
+    {
+        template<typename T>
+        bool Read(const std::uint8_t* data, std::size_t size, std::size_t offset, T& value)
+        {
+            if (offset > size || size - offset < sizeof(T))
+                return false;
+            std::memcpy(&value, data + offset, sizeof(T));
+            return true;
+        }
+    }
+
+    // Parse headers and section table. size bounds every read, so a truncated or hostile buffer returns nullopt instead of faulting.
+    inline std::optional<Layout> Parse(const std::uint8_t* data, std::size_t size)
+    {
+        using Detail::Read;
+
+        std::uint16_t dosMagic = 0;
+        std::uint32_t lfanew = 0;
+        if (!Read(data, size, 0, dosMagic) || dosMagic != 0x5A4D || !Read(data, size, 0x3C, lfanew))
+            return std::nullopt;
+
+        std::uint32_t ntSignature = 0;
+        if (!Read(data, size, lfanew, ntSignature) || ntSignature != 0x00004550)
+            return std::nullopt;
+
+        // IMAGE_FILE_HEADER
+        Layout layout;
+        std::size_t fileHeader = static_cast<std::size_t>(lfanew) + 4;
+        std::uint16_t numberOfSections = 0;
+        std::uint16_t sizeOfOptionalHeader = 0;
+        if (!Read(data, size, fileHeader + 0, layout.machine) ||
+            !Read(data, size, fileHeader + 2, numberOfSections) ||
+            !Read(data, size, fileHeader + 4, layout.timestamp) ||
+            !Read(data, size, fileHeader + 16, sizeOfOptionalHeader))
+            return std::nullopt;
+
+        // IMAGE_OPTIONAL_HEADER32/64, SizeOfImage and SizeOfHeaders share offsets in both
+        std::size_t optionalHeader = fileHeader + 20;
+        std::uint16_t magic = 0;
+        if (!Read(data, size, optionalHeader, magic))
+            return std::nullopt;
+        if (magic == 0x10B) {
+            std::uint32_t imageBase = 0;
+            if (!Read(data, size, optionalHeader + 28, imageBase))
+                return std::nullopt;
+            layout.imageBase = imageBase;
+        }
+        else if (magic == 0x20B) {
+            if (!Read(data, size, optionalHeader + 24, layout.imageBase))
+                return std::nullopt;
+        }
+        else {
+            return std::nullopt;
+        }
+        if (!Read(data, size, optionalHeader + 56, layout.sizeOfImage) || !Read(data, size, optionalHeader + 60, layout.sizeOfHeaders))
+            return std::nullopt;
+
+        // IMAGE_SECTION_HEADER array
+        std::size_t sectionTable = optionalHeader + sizeOfOptionalHeader;
+        for (std::uint16_t i = 0; i < numberOfSections; ++i) {
+            std::size_t header = sectionTable + i * 40;
+            char name[9] = {};
+            if (header > size || size - header < 40)
+                return std::nullopt;
+            std::memcpy(name, data + header, 8);
+
+            Section section;
+            section.name = name;
+            Read(data, size, header + 8, section.virtualSize);
+            Read(data, size, header + 12, section.virtualAddress);
+            Read(data, size, header + 16, section.rawSize);
+            Read(data, size, header + 20, section.rawOffset);
+            Read(data, size, header + 36, section.characteristics);
+            layout.sections.push_back(section);
+        }
+        return layout;
+    }
+}
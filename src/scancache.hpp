@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+// Persistent signature -> RVA cache so warm starts only have to verify addresses instead of scanning.
+// Platform-neutral, the caller supplies the build identity (timestamp + code hash).
+namespace ScanCache
+{
+    struct Key
+    {
+        std::uint32_t timestamp = 0;
+        std::uint64_t codeHash = 0;
+
+        bool operator==(const Key& other) const { return timestamp == other.timestamp && codeHash == other.codeHash; }
+    };
+
+    // FNV-1a over the first 64 bytes of every 4 KB page plus the range size.
+    // Cheap enough to run on every launch, and every cached RVA is still verified against its signature.
+    inline std::uint64_t HashCode(const std::uint8_t* data, std::size_t size)
+    {
+        constexpr std::size_t kStride = 0x1000;
+        constexpr std::size_t kSample = 64;
+
+        std::uint64_t hash = 0xCBF29CE484222325ull;
+        auto mix = [&hash](std::uint64_t value) {
+            hash ^= value;
+            hash *= 0x100000001B3ull;
+        };
+
+        mix(size);
+        for (std::size_t page = 0; page < size; page += kStride) {
+            std::size_t count = size - page < kSample ? size - page : kSample;
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                std::uint64_t word;
+                std::memcpy(&word, data + page + i, sizeof(word));
+                mix(word);
+            }
+            for (; i < count; ++i)
+                mix(data[page + i]);
+        }
+        return hash;
+    }
+
+    class Cache
+    {
+    public:
+        // Load entries from path. Returns true if the file was written for the same build as key.
+        // Entries from another build are kept but flagged stale, see IsStale().
+        bool Load(const std::filesystem::path& path, const Key& key)
+        {
+            entries.clear();
+            bStale = true;
+
+            std::ifstream file(path);
+            std::string line;
+            if (!file || !std::getline(file, line) || line != kHeader)
+                return false;
+
+            Key fileKey;
+            if (!std::getline(file, line))
+                return false;
+            std::istringstream keyLine(line);
+            keyLine >> std::hex >> fileKey.timestamp >> fileKey.codeHash;
+            if (!keyLine)
+                return false;
+
+            while (std::getline(file, line)) {
+                // "<rva> <signature>"
+                std::size_t split = line.find(' ');
+                if (split == std::string::npos)
+                    continue;
+                std::uint32_t rva = static_cast<std::uint32_t>(std::strtoul(line.substr(0, split).c_str(), nullptr, 16));
+                entries[line.substr(split + 1)] = rva;
+            }
+
+            bStale = !(fileKey == key);
+            return !bStale;
+        }
+
+        bool Save(const std::filesystem::path& path, const Key& key) const
+        {
+            std::ofstream file(path, std::ios::trunc);
+            if (!file)
+                return false;
+
+            file << kHeader << "\n";
+            file << std::hex << key.timestamp << " " << key.codeHash << "\n";
+            for (const auto& [signature, rva] : entries)
+                file << std::hex << rva << " " << signature << "\n";
+            return static_cast<bool>(file);
+        }
+
+        bool Find(const char* signature, std::uint32_t& rva) const
+        {
+            auto it = entries.find(signature);
+            if (it == entries.end())
+                return false;
+            rva = it->second;
+            return true;
+        }
+
+        // Returns true if the stored value changed
+        bool Store(const char* signature, std::uint32_t rva)
+        {
+            auto [it, bInserted] = entries.try_emplace(signature, rva);
+            if (bInserted)
+                return true;
+            if (it->second == rva)
+                return false;
+            it->second = rva;
+            return true;
+        }
+
+        // Entries were loaded from a different build
+        bool IsStale() const { return bStale; }
+
+        void Clear() { entries.clear(); }
+
+        std::size_t Size() const { return entries.size(); }
+
+    private:
+        static constexpr const char* kHeader = "DAFix scan cache v1";
+
+        std::unordered_map<std::string, std::uint32_t> entries;
+        bool bStale = true;
+    };
+}
@@ -0,0 +1,772 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#define SCANNER_TARGET_SSE2
+#define SCANNER_TARGET_AVX2
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+#define SCANNER_TARGET_SSE2 __attribute__((target("sse2")))
+#define SCANNER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Platform-neutral signature scanner. Works on any byte range so it can be hosted outside the game (see tools/).
+namespace Scanner
+{
+    enum class Level {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // Non-owning view of a parsed signature, shared by compiled (Signature<N>) and runtime-parsed (Pattern) signatures
+    struct PatternView
+    {
+        const std::uint8_t* bytes = nullptr;    // Pre-masked pattern bytes
+        const std::uint8_t* mask = nullptr;     // 0xFF = literal, 0x00 = wildcard
+        std::size_t length = 0;
+        std::size_t anchor = 0;                 // Offset of the byte used to find candidates
+        std::size_t anchor2 = 0;                // Second byte compared alongside anchor, same as anchor for a single-byte anchor
+        std::size_t filter = 0;                 // Byte checked before full verification, Horspool-style
+        const char* text = nullptr;
+
+        constexpr std::size_t size() const { return length; }
+
+        bool operator==(const PatternView& other) const
+        {
+            return length == other.length && std::memcmp(bytes, other.bytes, length) == 0 && std::memcmp(mask, other.mask, length) == 0;
+        }
+    };
+
+    struct Run
+    {
+        std::size_t offset = 0;
+        std::size_t length = 0;
+    };
+
+    namespace Detail
+    {
+        constexpr std::size_t kMalformed = static_cast<std::size_t>(-1);
+
+        constexpr int HexValue(char c)
+        {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            return -1;
+        }
+
+        // Parse "8B ?? 05" style text. bytes/mask may be null to only count.
+        // Returns the byte count or kMalformed for anything other than space separated "XX", "?" or "??" tokens.
+        constexpr std::size_t Parse(std::string_view text, std::uint8_t* bytes, std::uint8_t* mask)
+        {
+            std::size_t count = 0;
+            std::size_t i = 0;
+            while (i < text.size()) {
+                if (text[i] == ' ') {
+                    ++i;
+                    continue;
+                }
+
+                std::size_t end = i;
+                while (end < text.size() && text[end] != ' ')
+                    ++end;
+                std::string_view token = text.substr(i, end - i);
+
+                if (token == "?" || token == "??") {
+                    if (bytes) {
+                        bytes[count] = 0x00;
+                        mask[count] = 0x00;
+                    }
+                }
+                else if (token.size() == 2 && HexValue(token[0]) >= 0 && HexValue(token[1]) >= 0) {
+                    if (bytes) {
+                        bytes[count] = static_cast<std::uint8_t>(HexValue(token[0]) * 16 + HexValue(token[1]));
+                        mask[count] = 0xFF;
+                    }
+                }
+                else {
+                    return kMalformed;
+                }
+                ++count;
+                i = end;
+            }
+            return count;
+        }
+
+        // Splits mask into runs of literal bytes, returns how many were written to runs (if non-null)
+        constexpr std::size_t FindRuns(const std::uint8_t* mask, std::size_t length, Run* runs)
+        {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < length;) {
+                if (!mask[i]) {
+                    ++i;
+                    continue;
+                }
+                std::size_t j = i;
+                while (j < length && mask[j])
+                    ++j;
+                if (runs)
+                    runs[count] = { i, j - i };
+                ++count;
+                i = j;
+            }
+            return count;
+        }
+
+        // Fill anchor fields of view from its mask.
+        // Anchors on the first literal byte and filters on the last, see Anchor() for choosing by byte frequency.
+        constexpr void Analyse(PatternView& view)
+        {
+            view.anchor = 0;
+            view.filter = 0;
+            bool bAnchorSet = false;
+            for (std::size_t i = 0; i < view.length;) {
+                if (!view.mask[i]) {
+                    ++i;
+                    continue;
+                }
+                if (!bAnchorSet) {
+                    view.anchor = i;
+                    bAnchorSet = true;
+                }
+                std::size_t j = i;
+                while (j < view.length && view.mask[j])
+                    ++j;
+                view.filter = j - 1;
+                i = j;
+            }
+            view.anchor2 = view.anchor;
+        }
+    }
+
+    // String literal usable as a template argument
+    template<std::size_t N>
+    struct Literal
+    {
+        char text[N] = {};
+
+        consteval Literal(const char (&str)[N])
+        {
+            for (std::size_t i = 0; i < N; ++i)
+                text[i] = str[i];
+        }
+
+        constexpr std::string_view view() const { return { text, N - 1 }; }
+    };
+
+    // Signature compiled from a string literal, see Compile()
+    template<std::size_t N>
+    struct Signature
+    {
+        std::array<std::uint8_t, N> bytes = {};
+        std::array<std::uint8_t, N> mask = {};
+        std::array<Run, (N + 1) / 2> runs = {};
+        std::size_t runCount = 0;
+        PatternView view = {};
+
+        constexpr operator PatternView() const
+        {
+            PatternView result = view;
+            result.bytes = bytes.data();
+            result.mask = mask.data();
+            return result;
+        }
+
+        constexpr std::size_t size() const { return N; }
+    };
+
+    // Compile a signature at build time: Scanner::Compile<"8B ?? 05">().
+    // A malformed pattern or one without any literal byte fails to compile.
+    template<Literal S>
+    consteval auto Compile()
+    {
+        constexpr std::size_t length = Detail::Parse(S.view(), nullptr, nullptr);
+        static_assert(length != Detail::kMalformed, "Malformed signature, expected space separated \"XX\" or \"??\" tokens.");
+        static_assert(length != 0, "Empty signature.");
+
+        Signature<length> signature;
+        Detail::Parse(S.view(), signature.bytes.data(), signature.mask.data());
+        signature.runCount = Detail::FindRuns(signature.mask.data(), length, signature.runs.data());
+        if (signature.runCount == 0)
+            throw "Signature has no literal bytes.";
+
+        // Pointers into signature can't escape constant evaluation, operator PatternView() rebinds them
+        signature.view.length = length;
+        signature.view.text = S.text;
+        signature.view.bytes = signature.bytes.data();
+        signature.view.mask = signature.mask.data();
+        Detail::Analyse(signature.view);
+        signature.view.bytes = nullptr;
+        signature.view.mask = nullptr;
+        return signature;
+    }
+
+    // Owning, runtime-parsed signature for patterns that aren't known at build time (tools, config)
+    struct Pattern
+    {
+        std::vector<std::uint8_t> bytes;
+        std::vector<std::uint8_t> mask;
+        std::string text;
+        PatternView view = {};
+
+        Pattern() = default;
+        Pattern(const Pattern& other) : bytes(other.bytes), mask(other.mask), text(other.text), view(other.view) { Rebind(); }
+        Pattern& operator=(const Pattern& other)
+        {
+            bytes = other.bytes;
+            mask = other.mask;
+            text = other.text;
+            view = other.view;
+            Rebind();
+            return *this;
+        }
+
+        operator PatternView() const { return view; }
+        std::size_t size() const { return bytes.size(); }
+
+        void Rebind()
+        {
+            view.bytes = bytes.data();
+            view.mask = mask.data();
+            view.length = bytes.size();
+            view.text = text.c_str();
+        }
+    };
+
+    // Parse a signature at runtime. Malformed text yields an empty pattern, which never matches.
+    inline Pattern ParsePattern(const char* signature)
+    {
+        Pattern pattern;
+        pattern.text = signature;
+        std::size_t length = Detail::Parse(signature, nullptr, nullptr);
+        if (length != Detail::kMalformed) {
+            pattern.bytes.resize(length);
+            pattern.mask.resize(length);
+            Detail::Parse(signature, pattern.bytes.data(), pattern.mask.data());
+        }
+        pattern.Rebind();
+        Detail::Analyse(pattern.view);
+        return pattern;
+    }
+
+    inline Level DetectLevel()
+    {
+        bool bSSE2 = false;
+        bool bAVX2 = false;
+#if defined(_MSC_VER)
+        int info[4] = {};
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bSSE2 = (info[3] & (1 << 26)) != 0;
+        bool bOSXSAVE = (info[2] & (1 << 27)) != 0;
+        bool bAVX = (info[2] & (1 << 28)) != 0;
+        if (maxLeaf >= 7 && bOSXSAVE && bAVX) {
+            // OS must save YMM state (XCR0 bits 1 and 2)
+            if ((_xgetbv(0) & 0x6) == 0x6) {
+                __cpuidex(info, 7, 0);
+                bAVX2 = (info[1] & (1 << 5)) != 0;
+            }
+        }
+#else
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            bSSE2 = (edx & (1u << 26)) != 0;
+            bool bOSXSAVE = (ecx & (1u << 27)) != 0;
+            bool bAVX = (ecx & (1u << 28)) != 0;
+            if (bOSXSAVE && bAVX) {
+                unsigned int xcr0Lo = 0, xcr0Hi = 0;
+                __asm__ volatile("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+                if ((xcr0Lo & 0x6) == 0x6 && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+                    bAVX2 = (ebx & (1u << 5)) != 0;
+            }
+        }
+#endif
+        if (bAVX2)
+            return Level::AVX2;
+        if (bSSE2)
+            return Level::SSE2;
+        return Level::Scalar;
+    }
+
+    inline Level SupportedLevel()
+    {
+        static const Level level = DetectLevel();
+        return level;
+    }
+
+    inline const char* LevelName(Level level)
+    {
+        switch (level) {
+        case Level::AVX2: return "AVX2";
+        case Level::SSE2: return "SSE2";
+        default: return "Scalar";
+        }
+    }
+
+    namespace Detail
+    {
+        inline bool MatchScalar(const std::uint8_t* data, const PatternView& pattern, std::size_t from)
+        {
+            for (std::size_t j = from; j < pattern.length; ++j) {
+                if ((data[j] & pattern.mask[j]) != pattern.bytes[j])
+                    return false;
+            }
+            return true;
+        }
+
+        SCANNER_TARGET_SSE2 inline bool MatchSSE2(const std::uint8_t* data, const PatternView& pattern)
+        {
+            // Masked compare 16 bytes at a time, never reading past the candidate
+            std::size_t j = 0;
+            for (; j + 16 <= pattern.length; j += 16) {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j));
+                __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.mask + j));
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.bytes + j));
+                __m128i eq = _mm_cmpeq_epi8(_mm_and_si128(chunk, mask), bytes);
+                if (_mm_movemask_epi8(eq) != 0xFFFF)
+                    return false;
+            }
+            return MatchScalar(data, pattern, j);
+        }
+
+        // Candidate whose anchor bytes already matched: cheap filter byte first, then the whole pattern
+        SCANNER_TARGET_SSE2 inline bool Verify(const std::uint8_t* candidate, const PatternView& pattern)
+        {
+            return candidate[pattern.filter] == pattern.bytes[pattern.filter] && MatchSSE2(candidate, pattern);
+        }
+
+        inline const std::uint8_t* FindScalar(const std::uint8_t* data, std::size_t size, const PatternView& pattern)
+        {
+            // memchr jumps between anchor bytes, which sit at candidate + anchor
+            const std::size_t anchor = pattern.anchor;
+            const std::uint8_t* end = data + (size - pattern.length) + anchor + 1;
+            for (const std::uint8_t* current = data + anchor; current < end; ++current) {
+                current = static_cast<const std::uint8_t*>(std::memchr(current, pattern.bytes[anchor], end - current));
+                if (!current)
+                    break;
+                const std::uint8_t* candidate = current - anchor;
+                if (candidate[pattern.anchor2] == pattern.bytes[pattern.anchor2] && candidate[pattern.filter] == pattern.bytes[pattern.filter] &&
+                    MatchScalar(candidate, pattern, 0))
+                    return candidate;
+            }
+            return nullptr;
+        }
+
+        SCANNER_TARGET_SSE2 inline const std::uint8_t* FindSSE2(const std::uint8_t* data, std::size_t size, const PatternView& pattern)
+        {
+            const std::size_t anchor = pattern.anchor;
+            const std::size_t anchor2 = pattern.anchor2;
+            const std::size_t last = size - pattern.length;
+            const __m128i needle = _mm_set1_epi8(static_cast<char>(pattern.bytes[anchor]));
+            const __m128i needle2 = _mm_set1_epi8(static_cast<char>(pattern.bytes[anchor2]));
+
+            // i is the candidate start, the anchor bytes sit at i + anchor and i + anchor2
+            std::size_t i = 0;
+            for (; i + 16 <= last + 1; i += 16) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + anchor));
+                __m128i block2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + anchor2));
+                __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(block, needle), _mm_cmpeq_epi8(block2, needle2));
+                unsigned int hits = static_cast<unsigned int>(_mm_movemask_epi8(eq));
+                while (hits) {
+#if defined(_MSC_VER)
+                    unsigned long bit;
+                    _BitScanForward(&bit, hits);
+#else
+                    unsigned int bit = __builtin_ctz(hits);
+#endif
+                    if (Verify(data + i + bit, pattern))
+                        return data + i + bit;
+                    hits &= hits - 1;
+                }
+            }
+            for (; i <= last; ++i) {
+                if (data[i + anchor] == pattern.bytes[anchor] && data[i + anchor2] == pattern.bytes[anchor2] && Verify(data + i, pattern))
+                    return data + i;
+            }
+            return nullptr;
+        }
+
+        SCANNER_TARGET_AVX2 inline const std::uint8_t* FindAVX2(const std::uint8_t* data, std::size_t size, const PatternView& pattern)
+        {
+            const std::size_t anchor = pattern.anchor;
+            const std::size_t anchor2 = pattern.anchor2;
+            const std::size_t last = size - pattern.length;
+            const __m256i needle = _mm256_set1_epi8(static_cast<char>(pattern.bytes[anchor]));
+            const __m256i needle2 = _mm256_set1_epi8(static_cast<char>(pattern.bytes[anchor2]));
+
+            std::size_t i = 0;
+            for (; i + 32 <= last + 1; i += 32) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + anchor));
+                __m256i block2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + anchor2));
+                __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(block, needle), _mm256_cmpeq_epi8(block2, needle2));
+                unsigned int hits = static_cast<unsigned int>(_mm256_movemask_epi8(eq));
+                while (hits) {
+#if defined(_MSC_VER)
+                    unsigned long bit;
+                    _BitScanForward(&bit, hits);
+#else
+                    unsigned int bit = __builtin_ctz(hits);
+#endif
+                    if (Verify(data + i + bit, pattern))
+                        return data + i + bit;
+                    hits &= hits - 1;
+                }
+            }
+            for (; i <= last; ++i) {
+                if (data[i + anchor] == pattern.bytes[anchor] && data[i + anchor2] == pattern.bytes[anchor2] && Verify(data + i, pattern))
+                    return data + i;
+            }
+            return nullptr;
+        }
+    }
+
+    // Returns the lowest address in [data, data + size) matching pattern, or nullptr.
+    inline const std::uint8_t* Find(const std::uint8_t* data, std::size_t size, const PatternView& pattern, Level level)
+    {
+        if (pattern.length == 0 || size < pattern.length)
+            return nullptr;
+
+        // All-wildcard patterns have no anchor to search for
+        if (pattern.mask[pattern.anchor] == 0x00)
+            return data;
+
+        switch (level) {
+        case Level::AVX2: return Detail::FindAVX2(data, size, pattern);
+        case Level::SSE2: return Detail::FindSSE2(data, size, pattern);
+        default: return Detail::FindScalar(data, size, pattern);
+        }
+    }
+
+    inline const std::uint8_t* Find(const std::uint8_t* data, std::size_t size, const PatternView& pattern)
+    {
+        return Find(data, size, pattern, SupportedLevel());
+    }
+
+    // Does data match pattern in place? Validates a previously resolved address without scanning.
+    inline bool Matches(const std::uint8_t* data, const PatternView& pattern)
+    {
+        return pattern.length && Detail::MatchScalar(data, pattern, 0);
+    }
+
+    // Byte and adjacent byte pair frequencies of the scanned range, built once and shared by every signature scanned over it.
+    // x86 code is dominated by a few opcodes (8B, 89, FF, ...), anchoring on them makes nearly every position a candidate.
+    constexpr std::size_t kProfilePage = 4096;
+    constexpr std::size_t kProfileStride = 8 * kProfilePage;
+
+    struct Profile
+    {
+        std::array<std::uint32_t, 256> bytes = {};
+        std::vector<std::uint32_t> pairs;       // Indexed first << 8 | second
+        std::size_t size = 0;
+
+        // Ranges can be added one after another, pairs don't span them
+        void Add(const std::uint8_t* data, std::size_t count)
+        {
+            if (pairs.empty())
+                pairs.assign(256 * 256, 0);
+            if (!count)
+                return;
+            for (std::size_t i = 0; i + 1 < count; ++i) {
+                ++bytes[data[i]];
+                ++pairs[data[i] << 8 | data[i + 1]];
+            }
+            ++bytes[data[count - 1]];
+            size += count;
+        }
+
+        // Every kProfileStride-th page is enough to rank bytes in a large range at a fraction of the cost, small ranges are added whole
+        void Sample(const std::uint8_t* data, std::size_t count)
+        {
+            if (count <= kProfileStride * 16) {
+                Add(data, count);
+                return;
+            }
+            for (std::size_t offset = 0; offset < count; offset += kProfileStride)
+                Add(data + offset, std::min(kProfilePage, count - offset));
+        }
+    };
+
+    inline Profile BuildProfile(const std::uint8_t* data, std::size_t size)
+    {
+        Profile profile;
+        profile.Add(data, size);
+        return profile;
+    }
+
+    // Re-anchor pattern on its rarest bytes in profile: the rarest adjacent literal pair, or the two rarest literal bytes
+    // (assumed independent), whichever should yield fewer candidates. The rarest remaining literal becomes the filter.
+    // The result still points at pattern's bytes and matches exactly what pattern does.
+    inline PatternView Anchor(PatternView pattern, const Profile& profile)
+    {
+        constexpr std::size_t kNone = static_cast<std::size_t>(-1);
+        if (!profile.size || profile.pairs.empty())
+            return pattern;
+
+        auto count = [&](std::size_t i) { return profile.bytes[pattern.bytes[i]]; };
+        std::size_t first = kNone;
+        std::size_t second = kNone;
+        for (std::size_t i = 0; i < pattern.length; ++i) {
+            if (!pattern.mask[i])
+                continue;
+            if (first == kNone || count(i) < count(first)) {
+                second = first;
+                first = i;
+            }
+            else if (second == kNone || count(i) < count(second)) {
+                second = i;
+            }
+        }
+        if (first == kNone)
+            return pattern;
+
+        pattern.anchor = pattern.anchor2 = pattern.filter = first;
+        if (second == kNone)
+            return pattern;
+
+        double best = static_cast<double>(count(first)) * count(second) / profile.size;
+        pattern.anchor2 = second;
+        for (std::size_t i = 0; i + 1 < pattern.length; ++i) {
+            if (!pattern.mask[i] || !pattern.mask[i + 1])
+                continue;
+            double pairs = profile.pairs[pattern.bytes[i] << 8 | pattern.bytes[i + 1]];
+            if (pairs < best) {
+                best = pairs;
+                bool bFirstRarer = count(i) <= count(i + 1);
+                pattern.anchor = bFirstRarer ? i : i + 1;
+                pattern.anchor2 = bFirstRarer ? i + 1 : i;
+            }
+        }
+
+        for (std::size_t i = 0; i < pattern.length; ++i) {
+            if (!pattern.mask[i] || i == pattern.anchor || i == pattern.anchor2)
+                continue;
+            if (pattern.filter == pattern.anchor || pattern.filter == pattern.anchor2 || count(i) < count(pattern.filter))
+                pattern.filter = i;
+        }
+        return pattern;
+    }
+
+    constexpr std::size_t kNearWindow = 4 * 1024;           // First window either side of a hint, grows 4x per round
+    constexpr std::size_t kMaxNearWindow = 1024 * 1024;
+
+    // Searches outward from data + hint, the nearest match wins. A signature that moved a little after a game update is
+    // found after a few KB instead of a full scan. Returns nullptr if nothing matches within maxWindow bytes of the hint,
+    // callers then fall back to Find().
+    inline const std::uint8_t* FindNear(const std::uint8_t* data, std::size_t size, std::size_t hint, const PatternView& pattern, std::size_t maxWindow = kMaxNearWindow)
+    {
+        if (pattern.length == 0 || size < pattern.length)
+            return nullptr;
+
+        // [searchedBegin, searchedEnd) are match start offsets already covered
+        const std::size_t lastStart = size - pattern.length;
+        hint = std::min(hint, lastStart);
+        std::size_t searchedBegin = hint;
+        std::size_t searchedEnd = hint;
+        for (std::size_t window = std::min(kNearWindow, maxWindow);; window = std::min(window * 4, maxWindow)) {
+            std::size_t begin = hint > window ? hint - window : 0;
+            std::size_t end = std::min(hint + window, lastStart) + 1;
+
+            // Left of what's been searched the nearest match is the last one, right of it the first one
+            const std::uint8_t* left = nullptr;
+            const std::uint8_t* leftEnd = data + searchedBegin + pattern.length - 1;
+            for (const std::uint8_t* current = data + begin; current < data + searchedBegin;) {
+                const std::uint8_t* result = Find(current, leftEnd - current, pattern);
+                if (!result)
+                    break;
+                left = result;
+                current = result + 1;
+            }
+            const std::uint8_t* right = searchedEnd < end ? Find(data + searchedEnd, end - searchedEnd + pattern.length - 1, pattern) : nullptr;
+
+            if (left || right) {
+                if (!left)
+                    return right;
+                if (!right)
+                    return left;
+                return static_cast<std::size_t>(data + hint - left) <= static_cast<std::size_t>(right - (data + hint)) ? left : right;
+            }
+            searchedBegin = begin;
+            searchedEnd = end;
+            if (window >= maxWindow || (begin == 0 && end == lastStart + 1))
+                return nullptr;
+        }
+    }
+
+    // Images below this size are scanned on the calling thread, spinning up workers costs more than it saves
+    constexpr std::size_t kParallelThreshold = 4 * 1024 * 1024;
+    constexpr std::size_t kMinChunkSize = 256 * 1024;
+    constexpr std::size_t kMaxWorkers = 16;
+
+    // Worker threads to use for size bytes. threads = 0 picks one per core.
+    inline std::size_t WorkerCount(std::size_t size, std::size_t threads = 0)
+    {
+        if (size < kParallelThreshold)
+            return 1;
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads > kMaxWorkers)
+            threads = kMaxWorkers;
+        if (threads > size / kMinChunkSize)
+            threads = size / kMinChunkSize;
+        return threads ? threads : 1;
+    }
+
+    namespace Detail
+    {
+        // A few chunks per worker so one that stops early doesn't leave the others idle
+        inline std::size_t ChunkSize(std::size_t size, std::size_t workers)
+        {
+            std::size_t chunkSize = size / (workers * 4);
+            return chunkSize < kMinChunkSize ? kMinChunkSize : chunkSize;
+        }
+
+        // Call fn(chunk) for every chunk in [0, count) on up to workers threads (the caller being one of them).
+        // Chunks are handed out lowest first, so early matches let later chunks be skipped.
+        template<typename Fn>
+        void ForEachChunk(std::size_t count, std::size_t workers, Fn&& fn)
+        {
+            std::atomic<std::size_t> next = 0;
+            auto worker = [&] {
+                for (std::size_t chunk = next.fetch_add(1); chunk < count; chunk = next.fetch_add(1))
+                    fn(chunk);
+            };
+
+            std::vector<std::thread> pool;
+            for (std::size_t i = 1; i < workers && i < count; ++i)
+                pool.emplace_back(worker);
+            worker();
+            for (auto& thread : pool)
+                thread.join();
+        }
+    }
+
+    // Find() split across worker threads. Chunks overlap by pattern.length - 1 bytes so a match straddling a boundary
+    // is still seen whole, and the lowest address wins, so the result is always identical to Find().
+    inline const std::uint8_t* FindParallel(const std::uint8_t* data, std::size_t size, const PatternView& pattern, std::size_t threads = 0)
+    {
+        std::size_t workers = WorkerCount(size, threads);
+        if (workers <= 1 || pattern.length == 0 || size < pattern.length)
+            return Find(data, size, pattern);
+
+        const std::size_t chunkSize = Detail::ChunkSize(size, workers);
+        const std::size_t chunks = (size + chunkSize - 1) / chunkSize;
+        std::atomic<std::size_t> best = size;   // Offset of the lowest match so far
+
+        Detail::ForEachChunk(chunks, workers, [&](std::size_t chunk) {
+            std::size_t begin = chunk * chunkSize;
+            if (begin >= best.load(std::memory_order_relaxed))
+                return;
+            std::size_t end = begin + chunkSize + pattern.length - 1;
+            if (end > size)
+                end = size;
+            if (auto result = Find(data + begin, end - begin, pattern)) {
+                std::size_t offset = result - data;
+                std::size_t current = best.load(std::memory_order_relaxed);
+                while (offset < current && !best.compare_exchange_weak(current, offset, std::memory_order_relaxed)) {}
+            }
+        });
+
+        std::size_t offset = best.load();
+        return offset < size ? data + offset : nullptr;
+    }
+}
+
+namespace Scanner
+{
+    // A set of signatures resolved together, de-duplicated and seedable from caches, hints or the disk scan.
+    // Run() is not a single pass: it builds the range's byte profile once, then makes one FindParallel() sweep per
+    // unresolved signature, anchored on its rarest bytes (see Anchor()). For the dozen or so signatures DAFix has that
+    // beats feeding every byte through one multi-pattern automaton by a wide margin.
+    // Signatures are held by view, so they must outlive the batch (compiled signatures are static).
+    class Batch
+    {
+    public:
+        // Register a signature, identical signatures share one slot and therefore one result
+        std::size_t Add(const PatternView& pattern)
+        {
+            if (std::size_t id = Id(pattern); id != kNotFound)
+                return id;
+
+            entries.push_back({ pattern, nullptr });
+            return entries.size() - 1;
+        }
+
+        // Provide a result found elsewhere (e.g. by an earlier single scan) so Run() skips it
+        void Seed(const PatternView& pattern, const std::uint8_t* result)
+        {
+            entries[Add(pattern)].result = result;
+        }
+
+        // Resolve every unresolved signature with its own sweep over [data, data + size), lowest address wins.
+        // Large images are split into chunks across threads (threads = 0 picks one per core), see FindParallel().
+        void Run(const std::uint8_t* data, std::size_t size, std::size_t threads = 0)
+        {
+            if (Resolved() == entries.size())
+                return;
+
+            Profile profile;
+            profile.Sample(data, size);
+            for (auto& entry : entries) {
+                if (!entry.result)
+                    entry.result = FindParallel(data, size, Anchor(entry.pattern, profile), threads);
+            }
+        }
+
+        const std::uint8_t* Result(const PatternView& pattern) const
+        {
+            std::size_t id = Id(pattern);
+            return id != kNotFound ? entries[id].result : nullptr;
+        }
+
+        // Signatures after de-duplication
+        std::size_t Count() const { return entries.size(); }
+
+        std::size_t Resolved() const
+        {
+            std::size_t count = 0;
+            for (const auto& entry : entries) {
+                if (entry.result)
+                    ++count;
+            }
+            return count;
+        }
+
+    private:
+        static constexpr std::size_t kNotFound = static_cast<std::size_t>(-1);
+
+        struct Entry
+        {
+            PatternView pattern;
+            const std::uint8_t* result = nullptr;
+        };
+
+        std::size_t Id(const PatternView& pattern) const
+        {
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                if (entries[i].pattern == pattern)
+                    return i;
+            }
+            return kNotFound;
+        }
+
+        std::vector<Entry> entries;
+    };
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "scanner.hpp"
+
+// Every signature DAFix uses, compiled to byte/mask arrays at build time.
+// Shared by the DLL and the offline tools so both always scan for exactly the same bytes.
+namespace Signatures
+{
+    constexpr auto GameInit = Scanner::Compile<"D9 ?? ?? ?? D9 ?? ?? ?? ?? ?? 32 ?? 5E 8B ?? 5D C2 ?? ??">();
+    constexpr auto CurrentResolutionA = Scanner::Compile<"D9 ?? ?? ?? ?? ?? 85 ?? DB ?? ?? ?? ?? ?? ?? 7D ?? D8 ?? ?? ?? ?? ??">();
+    constexpr auto CurrentResolutionB = Scanner::Compile<"DB ?? ?? ?? ?? ?? ?? 85 ?? 7D ?? D8 ?? ?? ?? ?? ?? 8B ?? ?? ?? ?? ?? ?? D9 ?? ?? ?? ?? ?? D9 ??">();
+    constexpr Scanner::PatternView CurrentResolution[] = { CurrentResolutionA, CurrentResolutionB };
+    constexpr auto DA1_Borderless = Scanner::Compile<"74 ?? 8B ?? ?? ?? ?? ?? ?? ?? 50 FF ?? ?? ?? ?? ?? 5E C3">();
+    constexpr auto DA2_Borderless = Scanner::Compile<"8B ?? ?? 52 FF ?? 8B ?? ?? ?? ?? ?? 8B ?? 8A ??">();
+    constexpr auto DA1_SpeedtreeCulling = Scanner::Compile<"F6 ?? 05 7B ?? D9 ?? ?? ?? ?? ?? DE ?? D9 ?? ?? ?? ?? ??">();
+    constexpr auto DA1_ShadowAspectRatio = Scanner::Compile<"8B ?? 8B ?? ?? ?? ?? ?? 8B ?? FF ?? DC ?? ?? ?? ?? ?? D9 ?? ?? ?? D9 ?? ?? ?? E8 ?? ?? ?? ??">();
+    constexpr auto DA1_Pillarboxing = Scanner::Compile<"FF ?? 8B ?? ?? ?? ?? ?? 85 C0 74 ?? C6 ?? ?? 01">();
+    constexpr auto DA2_Pillarboxing = Scanner::Compile<"89 ?? ?? ?? 89 ?? ?? ?? EB ?? DD ?? DE ?? DF ?? F6 ?? ?? 7A ??">();
+    constexpr const auto& DA1_DA2_DialogFOV = GameInit;
+    constexpr auto DA1_HUDScale = Scanner::Compile<"D9 ?? ?? ?? 8B ?? D9 ?? ?? ?? D9 ?? ?? ?? 8B ?? ?? 53">();
+    constexpr auto DA1_FoliageDrawDistance = Scanner::Compile<"D9 ?? ?? ?? ?? ?? D9 ?? ?? ?? ?? ?? D9 ?? ?? ?? ?? ?? EB ?? D9 ?? ?? ?? ?? ?? D9 ?? ?? ?? ?? ??">();
+    constexpr auto DA1_ObjectDrawDistance = Scanner::Compile<"D9 ?? ?? ?? ?? ?? DE ?? DF ?? F6 ?? ?? 74 ?? C6 ?? ?? ?? 00">();
+    constexpr auto DA1_DA2_ShadowResolutionA = Scanner::Compile<"C7 ?? ?? ?? ?? ?? 00 04 00 00 56 57 E8 ?? ?? ?? ??">();
+    constexpr auto DA1_DA2_ShadowResolutionB = Scanner::Compile<"C7 ?? ?? ?? ?? ?? 00 10 00 00 E8 ?? ?? ?? ?? 8B ?? 8B ?? 8B ?? ?? FF ??">();
+    constexpr Scanner::PatternView DA1_DA2_ShadowResolution[] = { DA1_DA2_ShadowResolutionA, DA1_DA2_ShadowResolutionB };
+
+    // Games a signature is scanned in
+    constexpr unsigned kDA1 = 1 << 0;
+    constexpr unsigned kDA2 = 1 << 1;
+
+    struct Entry
+    {
+        const char* name;
+        const char* feature;    // Alternatives for the same patch share a feature, only one of them has to match
+        Scanner::PatternView pattern;
+        unsigned games;
+    };
+
+    // Alternatives (A/B) are listed in the order they are tried
+    inline constexpr Entry kAll[] = {
+        { "GameInit", "GameInit", GameInit, kDA1 | kDA2 },
+        { "CurrentResolutionA", "CurrentResolution", CurrentResolutionA, kDA1 | kDA2 },
+        { "CurrentResolutionB", "CurrentResolution", CurrentResolutionB, kDA1 | kDA2 },
+        { "DA1_DA2_ShadowResolutionA", "DA1_DA2_ShadowResolution", DA1_DA2_ShadowResolutionA, kDA1 | kDA2 },
+        { "DA1_DA2_ShadowResolutionB", "DA1_DA2_ShadowResolution", DA1_DA2_ShadowResolutionB, kDA1 | kDA2 },
+        { "DA1_Borderless", "DA1_Borderless", DA1_Borderless, kDA1 },
+        { "DA1_SpeedtreeCulling", "DA1_SpeedtreeCulling", DA1_SpeedtreeCulling, kDA1 },
+        { "DA1_ShadowAspectRatio", "DA1_ShadowAspectRatio", DA1_ShadowAspectRatio, kDA1 },
+        { "DA1_Pillarboxing", "DA1_Pillarboxing", DA1_Pillarboxing, kDA1 },
+        { "DA1_HUDScale", "DA1_HUDScale", DA1_HUDScale, kDA1 },
+        { "DA1_FoliageDrawDistance", "DA1_FoliageDrawDistance", DA1_FoliageDrawDistance, kDA1 },
+        { "DA1_ObjectDrawDistance", "DA1_ObjectDrawDistance", DA1_ObjectDrawDistance, kDA1 },
+        { "DA2_Borderless", "DA2_Borderless", DA2_Borderless, kDA2 },
+        { "DA2_Pillarboxing", "DA2_Pillarboxing", DA2_Pillarboxing, kDA2 },
+    };
+}
@@ -4,9 +4,11 @@
 
 #include <cassert>
 #include <windows.h>
+#include <d3d9.h>
 #include <fstream>
 #include <iostream>
 #include <inttypes.h>
 #include <filesystem>
+#include <span>
 #include <string>
 #include <unordered_set>
\ No newline at end of file
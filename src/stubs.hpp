@@ -0,0 +1,386 @@
+#pragma once
+
+#include "hooks.hpp"
+
+#include <Zydis.h>
+#include <safetyhook.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Register/stack patch stubs. Hooks that only store values into registers or stack slots don't need safetyhook's mid hook,
+// which saves and restores the whole context and makes an indirect call every time. Instead a few instructions are emitted
+// per site: load the published state pointer, store each value, continue at the trampoline.
+// Stubs are 32-bit code, encoded and checked with the bundled Zydis without touching the game (see tools/dafix-stubs.cpp).
+// The DLL only installs them when built with DAFIX_STUB_HOOKS, see QueueStubHook() in dllmain.cpp.
+namespace Stubs
+{
+    // Stack destinations are esp-relative as of the hooked instruction, same as SafetyHookContext::esp
+    struct Destination
+    {
+        ZydisRegister reg = ZYDIS_REGISTER_NONE;    // NONE for a stack slot
+        std::int32_t stackOffset = 0;
+    };
+
+    constexpr Destination Register(ZydisRegister reg) { return { reg, 0 }; }
+    constexpr Destination Stack(std::int32_t offset) { return { ZYDIS_REGISTER_NONE, offset }; }
+
+    struct Source
+    {
+        bool bField = false;        // Dword at value bytes into the published state, otherwise value itself
+        std::uint32_t value = 0;
+    };
+
+    constexpr Source Constant(std::uint32_t value) { return { false, value }; }
+    constexpr Source Field(std::size_t offset) { return { true, static_cast<std::uint32_t>(offset) }; }
+
+    struct Store
+    {
+        Destination destination;
+        Source source;
+        bool bSkipZero = false;     // Leave the destination alone while the field is 0
+    };
+
+    // 32-bit absolute addresses the stub reads from
+    struct Layout
+    {
+        std::uint32_t state = 0;        // Pointer to the current state snapshot
+        std::uint32_t trampoline = 0;   // Slot holding the address to continue at
+    };
+
+    namespace Detail
+    {
+        constexpr ZydisRegister kScratch[] = { ZYDIS_REGISTER_EAX, ZYDIS_REGISTER_ECX, ZYDIS_REGISTER_EDX, ZYDIS_REGISTER_EBX,
+            ZYDIS_REGISTER_ESI, ZYDIS_REGISTER_EDI, ZYDIS_REGISTER_EBP };
+
+        inline bool IsGpr32(ZydisRegister reg)
+        {
+            return std::find(std::begin(kScratch), std::end(kScratch), reg) != std::end(kScratch);
+        }
+
+        inline ZydisEncoderOperand Reg(ZydisRegister reg)
+        {
+            ZydisEncoderOperand operand = {};
+            operand.type = ZYDIS_OPERAND_TYPE_REGISTER;
+            operand.reg.value = reg;
+            return operand;
+        }
+
+        // Dword at base + displacement, or at the absolute address displacement without a base
+        inline ZydisEncoderOperand Mem(ZydisRegister base, std::int64_t displacement)
+        {
+            ZydisEncoderOperand operand = {};
+            operand.type = ZYDIS_OPERAND_TYPE_MEMORY;
+            operand.mem.base = base;
+            operand.mem.index = ZYDIS_REGISTER_NONE;
+            operand.mem.displacement = displacement;
+            operand.mem.size = 4;
+            return operand;
+        }
+
+        inline ZydisEncoderOperand Imm(std::int64_t value)
+        {
+            ZydisEncoderOperand operand = {};
+            operand.type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+            operand.imm.s = value;
+            return operand;
+        }
+
+        inline std::int64_t Absolute(std::uint32_t address)
+        {
+            // Addresses above 2GB (large address aware) wrap to the same disp32 bits
+            return static_cast<std::int32_t>(address);
+        }
+
+        inline bool Emit(std::vector<std::uint8_t>& code, ZydisMnemonic mnemonic, std::initializer_list<ZydisEncoderOperand> operands,
+            ZydisBranchType branchType = ZYDIS_BRANCH_TYPE_NONE)
+        {
+            ZydisEncoderRequest request;
+            std::memset(&request, 0, sizeof(request));
+            request.machine_mode = ZYDIS_MACHINE_MODE_LEGACY_32;
+            request.mnemonic = mnemonic;
+            request.branch_type = branchType;
+            request.operand_count = static_cast<ZyanU8>(operands.size());
+            std::copy(operands.begin(), operands.end(), request.operands);
+
+            ZyanU8 buffer[ZYDIS_MAX_INSTRUCTION_LENGTH];
+            ZyanUSize length = sizeof(buffer);
+            if (!ZYAN_SUCCESS(ZydisEncoderEncodeInstruction(&request, buffer, &length)))
+                return false;
+            code.insert(code.end(), buffer, buffer + length);
+            return true;
+        }
+    }
+
+    // Encodes stores followed by jmp [layout.trampoline]. Returns empty code for stores it can't express.
+    // A register destination fed from the state doubles as the state pointer and is written last, otherwise a scratch register
+    // is saved around the stub, plus a second one to copy fields to the stack. Flags are saved only around bSkipZero tests.
+    inline std::vector<std::uint8_t> Encode(std::span<const Store> stores, const Layout& layout)
+    {
+        using namespace Detail;
+
+        bool bFields = false;
+        bool bStackFields = false;
+        bool bSkips = false;
+        for (const auto& store : stores) {
+            if (store.destination.reg != ZYDIS_REGISTER_NONE && !IsGpr32(store.destination.reg))
+                return {};
+            bFields |= store.source.bField;
+            bStackFields |= store.source.bField && store.destination.reg == ZYDIS_REGISTER_NONE;
+            bSkips |= store.source.bField && store.bSkipZero;
+        }
+
+        auto isDestination = [&](ZydisRegister reg) {
+            return std::any_of(stores.begin(), stores.end(), [&](const Store& store) { return store.destination.reg == reg; });
+        };
+        auto freeScratch = [&](ZydisRegister except) {
+            for (ZydisRegister reg : kScratch) {
+                if (reg != except && !isDestination(reg))
+                    return reg;
+            }
+            return ZYDIS_REGISTER_NONE;
+        };
+
+        // State pointer: reuse an unconditional register destination if there is one
+        const Store* pointerStore = nullptr;
+        for (const auto& store : stores) {
+            if (store.source.bField && !store.bSkipZero && store.destination.reg != ZYDIS_REGISTER_NONE) {
+                pointerStore = &store;
+                break;
+            }
+        }
+        std::vector<ZydisRegister> saved;
+        ZydisRegister pointer = ZYDIS_REGISTER_NONE;
+        if (bFields) {
+            pointer = pointerStore ? pointerStore->destination.reg : freeScratch(ZYDIS_REGISTER_NONE);
+            if (!pointerStore)
+                saved.push_back(pointer);
+        }
+        ZydisRegister value = ZYDIS_REGISTER_NONE;
+        if (bStackFields) {
+            value = freeScratch(pointer);
+            saved.push_back(value);
+        }
+        if (std::find(saved.begin(), saved.end(), ZYDIS_REGISTER_NONE) != saved.end())
+            return {};
+
+        std::vector<std::uint8_t> code;
+        bool bOk = true;
+        for (ZydisRegister reg : saved)
+            bOk &= Emit(code, ZYDIS_MNEMONIC_PUSH, { Reg(reg) });
+        if (bSkips)
+            bOk &= Emit(code, ZYDIS_MNEMONIC_PUSHFD, {});
+        const std::int64_t pushed = 4 * (saved.size() + (bSkips ? 1 : 0));
+
+        if (bFields)
+            bOk &= Emit(code, ZYDIS_MNEMONIC_MOV, { Reg(pointer), Mem(ZYDIS_REGISTER_NONE, Absolute(layout.state)) });
+
+        auto emitStore = [&](std::vector<std::uint8_t>& out, const Store& store) {
+            const auto& destination = store.destination;
+            if (destination.reg != ZYDIS_REGISTER_NONE) {
+                if (store.source.bField)
+                    return Emit(out, ZYDIS_MNEMONIC_MOV, { Reg(destination.reg), Mem(pointer, store.source.value) });
+                return Emit(out, ZYDIS_MNEMONIC_MOV, { Reg(destination.reg), Imm(store.source.value) });
+            }
+            auto slot = Mem(ZYDIS_REGISTER_ESP, pushed + destination.stackOffset);
+            if (store.source.bField)
+                return Emit(out, ZYDIS_MNEMONIC_MOV, { Reg(value), Mem(pointer, store.source.value) }) && Emit(out, ZYDIS_MNEMONIC_MOV, { slot, Reg(value) });
+            return Emit(out, ZYDIS_MNEMONIC_MOV, { slot, Imm(static_cast<std::int32_t>(store.source.value)) });
+        };
+
+        for (const auto& store : stores) {
+            if (&store == pointerStore)
+                continue;
+            if (store.source.bField && store.bSkipZero) {
+                // cmp [field], 0 / jz over the store
+                std::vector<std::uint8_t> body;
+                bOk &= emitStore(body, store);
+                bOk &= Emit(code, ZYDIS_MNEMONIC_CMP, { Mem(pointer, store.source.value), Imm(0) });
+                bOk &= Emit(code, ZYDIS_MNEMONIC_JZ, { Imm(static_cast<std::int64_t>(body.size())) }, ZYDIS_BRANCH_TYPE_SHORT);
+                code.insert(code.end(), body.begin(), body.end());
+            }
+            else {
+                bOk &= emitStore(code, store);
+            }
+        }
+        if (pointerStore)
+            bOk &= emitStore(code, *pointerStore);
+
+        if (bSkips)
+            bOk &= Emit(code, ZYDIS_MNEMONIC_POPFD, {});
+        for (auto reg = saved.rbegin(); reg != saved.rend(); ++reg)
+            bOk &= Emit(code, ZYDIS_MNEMONIC_POP, { Reg(*reg) });
+        bOk &= Emit(code, ZYDIS_MNEMONIC_JMP, { Mem(ZYDIS_REGISTER_NONE, Absolute(layout.trampoline)) }, ZYDIS_BRANCH_TYPE_NEAR);
+
+        return bOk ? code : std::vector<std::uint8_t>{};
+    }
+
+    // Decodes code and checks it does what stores say and nothing else: every register it writes is a destination or saved and
+    // restored, every memory write lands on a destination stack slot, pushes and pops pair up, and it ends in jmp [layout.trampoline].
+    inline bool Check(std::span<const std::uint8_t> code, std::span<const Store> stores, const Layout& layout)
+    {
+        ZydisDecoder decoder;
+        if (!ZYAN_SUCCESS(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LEGACY_32, ZYDIS_STACK_WIDTH_32)))
+            return false;
+
+        auto isDestination = [&](ZydisRegister reg) {
+            return std::any_of(stores.begin(), stores.end(), [&](const Store& store) { return store.destination.reg == reg; });
+        };
+        auto isSlot = [&](std::int64_t offset) {
+            return std::any_of(stores.begin(), stores.end(), [&](const Store& store) {
+                return store.destination.reg == ZYDIS_REGISTER_NONE && store.destination.stackOffset == offset;
+            });
+        };
+
+        std::vector<ZydisRegister> saved;
+        std::size_t offset = 0;
+        while (offset < code.size()) {
+            ZydisDecodedInstruction instruction;
+            ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+            if (!ZYAN_SUCCESS(ZydisDecoderDecodeFull(&decoder, code.data() + offset, code.size() - offset, &instruction, operands)))
+                return false;
+            offset += instruction.length;
+            const auto& first = operands[0];
+
+            switch (instruction.mnemonic) {
+            case ZYDIS_MNEMONIC_PUSH:
+                if (first.type != ZYDIS_OPERAND_TYPE_REGISTER)
+                    return false;
+                saved.push_back(first.reg.value);
+                continue;
+            case ZYDIS_MNEMONIC_PUSHFD:
+                saved.push_back(ZYDIS_REGISTER_EFLAGS);
+                continue;
+            case ZYDIS_MNEMONIC_POP:
+            case ZYDIS_MNEMONIC_POPFD: {
+                ZydisRegister reg = instruction.mnemonic == ZYDIS_MNEMONIC_POPFD ? ZYDIS_REGISTER_EFLAGS : first.reg.value;
+                if (saved.empty() || saved.back() != reg)
+                    return false;
+                saved.pop_back();
+                continue;
+            }
+            case ZYDIS_MNEMONIC_JMP:
+                return offset == code.size() && saved.empty() && first.type == ZYDIS_OPERAND_TYPE_MEMORY && first.mem.base == ZYDIS_REGISTER_NONE &&
+                    static_cast<std::uint32_t>(first.mem.disp.value) == layout.trampoline;
+            case ZYDIS_MNEMONIC_MOV:
+            case ZYDIS_MNEMONIC_CMP:
+            case ZYDIS_MNEMONIC_JZ:
+                break;
+            default:
+                return false;
+            }
+
+            for (std::size_t i = 0; i < instruction.operand_count; ++i) {
+                const auto& operand = operands[i];
+                if (!(operand.actions & ZYDIS_OPERAND_ACTION_MASK_WRITE))
+                    continue;
+                if (operand.type == ZYDIS_OPERAND_TYPE_REGISTER) {
+                    ZydisRegister reg = operand.reg.value;
+                    bool bSaved = std::find(saved.begin(), saved.end(), reg) != saved.end();
+                    if (reg != ZYDIS_REGISTER_EIP && !isDestination(reg) && !bSaved)
+                        return false;
+                }
+                else if (operand.type == ZYDIS_OPERAND_TYPE_MEMORY) {
+                    if (operand.mem.base != ZYDIS_REGISTER_ESP || operand.mem.index != ZYDIS_REGISTER_NONE ||
+                        !isSlot(operand.mem.disp.value - 4 * static_cast<std::int64_t>(saved.size())))
+                        return false;
+                }
+            }
+        }
+        return false;
+    }
+
+    // A stub installed at target through an inline hook, whose trampoline runs the displaced instructions.
+    // Only 32-bit builds can install stubs, Create() fails elsewhere so callers can fall back to a mid hook.
+    class Hook
+    {
+    public:
+        // Bytes of code memory Create() needs for stores, the stub plus its trampoline slot. 0 if they can't be encoded.
+        static std::size_t CodeSize(std::span<const Store> stores)
+        {
+            // Instruction lengths don't depend on the addresses
+            std::size_t codeSize = Encode(stores, {}).size();
+            return codeSize ? ((codeSize + 3) & ~std::size_t(3)) + sizeof(std::uint32_t) : 0;
+        }
+
+        // state is the address of the pointer fields are read through. code (CodeSize() bytes of executable memory) is
+        // owned by the caller and must outlive the hook, the inline hook's trampoline comes from allocator.
+        bool Create(std::uint8_t* target, std::span<const Store> stores, const void* state, std::uint8_t* code, const std::shared_ptr<safetyhook::Allocator>& allocator)
+        {
+#if SAFETYHOOK_ARCH_X86_32
+            std::size_t size = CodeSize(stores);
+            if (!size || !code)
+                return false;
+            std::size_t slotOffset = size - sizeof(std::uint32_t);
+            Layout layout = { static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(state)), static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(code + slotOffset)) };
+            auto encoded = Encode(stores, layout);
+            if (encoded.size() > slotOffset || !Check(encoded, stores, layout))
+                return false;
+            std::copy(encoded.begin(), encoded.end(), code);
+
+            auto hook = safetyhook::InlineHook::create(allocator, target, code);
+            if (!hook)
+                return false;
+            std::uint32_t trampoline = static_cast<std::uint32_t>(hook->trampoline().address());
+            std::memcpy(code + slotOffset, &trampoline, sizeof(trampoline));
+
+            stub = code;
+            stubSize = size;
+            inlineHook = std::move(*hook);
+            return true;
+#else
+            (void)target;
+            (void)stores;
+            (void)state;
+            (void)code;
+            (void)allocator;
+            return false;
+#endif
+        }
+
+        // Unhooks, the caller may free the code afterwards
+        void Reset()
+        {
+            inlineHook = {};
+            stub = nullptr;
+            stubSize = 0;
+        }
+
+        explicit operator bool() const { return static_cast<bool>(inlineHook); }
+
+        const std::uint8_t* Code() const { return stub; }
+        std::size_t Size() const { return stubSize; }
+        const safetyhook::InlineHook& Inline() const { return inlineHook; }
+
+    private:
+        std::uint8_t* stub = nullptr;
+        std::size_t stubSize = 0;
+        safetyhook::InlineHook inlineHook;
+    };
+
+    // DAFix's store-only hooks, reading Hooks::ResolutionState snapshots. Same stores as Hooks::Pillarboxing<DA1/DA2> and
+    // Hooks::HUDScale. A stub is built once, so unlike the callbacks it keeps the HUD scale test rather than be reselected.
+    inline constexpr Store kDA1_Pillarboxing[] = {
+        { Stack(0x0), Constant(0) },                                        // Left
+        { Stack(0x4), Constant(0) },                                        // Right
+        { Stack(0x8), Field(offsetof(Hooks::Resolution, width)) },          // Width
+        { Stack(0xC), Field(offsetof(Hooks::Resolution, height)) },         // Height
+    };
+
+    inline constexpr Store kDA2_Pillarboxing[] = {
+        { Register(ZYDIS_REGISTER_EBX), Constant(0) },                      // Left
+        { Register(ZYDIS_REGISTER_EBP), Constant(0) },                      // Right
+        { Register(ZYDIS_REGISTER_ECX), Field(offsetof(Hooks::Resolution, width)) },
+        { Register(ZYDIS_REGISTER_EDX), Field(offsetof(Hooks::Resolution, height)) },
+    };
+
+    inline constexpr Store kHUDScale[] = {
+        { Stack(0x8), Field(offsetof(Hooks::Resolution, hudScale)), true }, // 0 leaves the game's scale alone
+    };
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Frame pacing telemetry. The per-frame hook pushes timestamps into a fixed-size ring, a background thread drains it,
+// writes the CSV and summarises each report window. Platform-neutral so it can be fed synthetic timestamps (see tools/dafix-bench.cpp).
+namespace Telemetry
+{
+    constexpr double kStutterFactor = 2.00;     // A frame taking this many times the window's median is a stutter
+
+    // Single producer / single consumer ring, storage is fixed at compile time so Push never allocates or blocks.
+    // A full ring drops the new value and counts it.
+    template<typename T, std::size_t N>
+    class Ring
+    {
+        static_assert(N && (N & (N - 1)) == 0, "Ring size must be a power of two");
+
+    public:
+        // Producer only
+        bool Push(const T& value)
+        {
+            std::size_t current = head.load(std::memory_order_relaxed);
+            if (current - tail.load(std::memory_order_acquire) == N) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            slots[current & (N - 1)] = value;
+            head.store(current + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only
+        bool Pop(T& value)
+        {
+            std::size_t current = tail.load(std::memory_order_relaxed);
+            if (current == head.load(std::memory_order_acquire))
+                return false;
+            value = slots[current & (N - 1)];
+            tail.store(current + 1, std::memory_order_release);
+            return true;
+        }
+
+        std::size_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    private:
+        alignas(64) std::atomic<std::size_t> head = 0;
+        alignas(64) std::atomic<std::size_t> tail = 0;
+        alignas(64) std::atomic<std::size_t> dropped = 0;
+        std::array<T, N> slots = {};
+    };
+
+    struct Report
+    {
+        std::size_t frames = 0;
+        double averageFps = 0.0;
+        double low1Fps = 0.0;       // FPS at the 99th percentile frame time
+        double low01Fps = 0.0;      // FPS at the 99.9th percentile frame time
+        double maxFrameMs = 0.0;
+        std::size_t stutters = 0;
+    };
+
+    // frameMs is sorted in place
+    inline Report Summarise(std::vector<double>& frameMs)
+    {
+        Report report;
+        report.frames = frameMs.size();
+        if (frameMs.empty())
+            return report;
+
+        double totalMs = 0.0;
+        for (double ms : frameMs)
+            totalMs += ms;
+        std::sort(frameMs.begin(), frameMs.end());
+
+        auto percentile = [&](double fraction) {
+            std::size_t rank = static_cast<std::size_t>(std::ceil(fraction * frameMs.size()));
+            return frameMs[std::clamp<std::size_t>(rank, 1, frameMs.size()) - 1];
+        };
+        double medianMs = percentile(0.50);
+        report.averageFps = totalMs > 0.0 ? report.frames * 1000.0 / totalMs : 0.0;
+        report.low1Fps = 1000.0 / percentile(0.99);
+        report.low01Fps = 1000.0 / percentile(0.999);
+        report.maxFrameMs = frameMs.back();
+        report.stutters = frameMs.end() - std::upper_bound(frameMs.begin(), frameMs.end(), medianMs * kStutterFactor);
+        return report;
+    }
+
+    // Consumer side: turns timestamps into frame times and keeps the current report window
+    class Capture
+    {
+    public:
+        // Frame time in ms ending at timestampNs, 0 for the first frame
+        double Add(std::int64_t timestampNs)
+        {
+            double frameMs = lastNs && timestampNs > lastNs ? (timestampNs - lastNs) / 1'000'000.0 : 0.0;
+            lastNs = timestampNs;
+            if (frameMs > 0.0)
+                window.push_back(frameMs);
+            ++frames;
+            return frameMs;
+        }
+
+        // Summarise and start a new window
+        Report TakeReport()
+        {
+            Report report = Summarise(window);
+            window.clear();
+            return report;
+        }
+
+        std::uint64_t Frames() const { return frames; }
+
+    private:
+        std::int64_t lastNs = 0;
+        std::uint64_t frames = 0;
+        std::vector<double> window;
+    };
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Borderless window reconciler. The borderless hooks only record which window should cover which rectangle, a background
+// thread applies the latest request at most once per interval and only makes the calls that change something: styles
+// that are already borderless aren't written again, and SWP_FRAMECHANGED (a frame recalculation and recomposition) is
+// only sent when a style was. Free of Windows, the DLL supplies the user32 Api, so the decisions can be checked with a mock
+// (see tools/dafix-bench.cpp).
+namespace Window
+{
+    using Handle = void*;
+
+    // WS_CAPTION | WS_THICKFRAME | WS_MINIMIZE | WS_MAXIMIZE | WS_SYSMENU
+    constexpr std::uint32_t kBorderStyle = 0x00C00000 | 0x00040000 | 0x20000000 | 0x01000000 | 0x00080000;
+    // WS_EX_DLGMODALFRAME | WS_EX_CLIENTEDGE | WS_EX_STATICEDGE
+    constexpr std::uint32_t kBorderExStyle = 0x00000001 | 0x00000200 | 0x00020000;
+
+    struct Rect
+    {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+
+        bool operator==(const Rect&) const = default;
+    };
+
+    struct State
+    {
+        std::uint32_t style = 0;
+        std::uint32_t exStyle = 0;
+        Rect rect;
+
+        bool operator==(const State&) const = default;
+    };
+
+    struct Stats
+    {
+        std::uint64_t requests = 0;
+        std::uint64_t applies = 0;          // Requests acted on, the rest were coalesced into a later one
+        std::uint64_t styleWrites = 0;
+        std::uint64_t placements = 0;
+        std::uint64_t frameChanges = 0;
+        std::uint64_t reverts = 0;          // Applies that found the game had changed the window since the last one
+    };
+
+    // Api provides Read(window) -> State, SetStyle(window, style), SetExStyle(window, exStyle) and Place(window, rect, bFrameChanged)
+    template<typename Api>
+    class Reconciler
+    {
+    public:
+        Reconciler(Api& api, std::chrono::milliseconds interval) : api(api), interval(interval) {}
+
+        // Any thread, typically the game's from a hook: records the request and wakes Next(), never touches the window
+        void Request(Handle window, const Rect& rect)
+        {
+            {
+                std::lock_guard lock(mutex);
+                pendingWindow = window;
+                pendingRect = rect;
+                bPending = true;
+                ++stats.requests;
+            }
+            wake.notify_one();
+        }
+
+        // Applies the latest request now if there is one. Returns true if it did.
+        bool Apply()
+        {
+            Handle window;
+            Rect rect;
+            {
+                std::lock_guard lock(mutex);
+                if (!bPending)
+                    return false;
+                window = pendingWindow;
+                rect = pendingRect;
+                bPending = false;
+            }
+            Reconcile(window, rect);
+            return true;
+        }
+
+        // Waits for a request, then for the rest of the interval since the last apply so a burst of requests
+        // (alt-tab, a resolution change) becomes one apply of the latest
+        void Next()
+        {
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [&] { return bPending; });
+            }
+            std::this_thread::sleep_until(lastApply + interval);
+            Apply();
+            lastApply = std::chrono::steady_clock::now();
+        }
+
+        // Worker loop for a reconciler that lives as long as the process
+        [[noreturn]] void Run()
+        {
+            for (;;)
+                Next();
+        }
+
+        Stats GetStats() const
+        {
+            std::lock_guard lock(mutex);
+            return stats;
+        }
+
+    private:
+        void Reconcile(Handle window, const Rect& rect)
+        {
+            // Reads are cheap, writes cost a frame recalculation each, so read the window and write only the difference
+            State current = api.Read(window);
+            State target = { current.style & ~kBorderStyle, current.exStyle & ~kBorderExStyle, rect };
+            bool bStyle = target.style != current.style;
+            bool bExStyle = target.exStyle != current.exStyle;
+            bool bRevert = bApplied && window == appliedWindow && !(current == applied);
+
+            if (bStyle)
+                api.SetStyle(window, target.style);
+            if (bExStyle)
+                api.SetExStyle(window, target.exStyle);
+            bool bFrameChanged = bStyle || bExStyle;
+            bool bPlace = bFrameChanged || current.rect != rect;
+            if (bPlace)
+                api.Place(window, rect, bFrameChanged);
+
+            std::lock_guard lock(mutex);
+            appliedWindow = window;
+            applied = target;
+            bApplied = true;
+            ++stats.applies;
+            stats.styleWrites += (bStyle ? 1 : 0) + (bExStyle ? 1 : 0);
+            stats.placements += bPlace ? 1 : 0;
+            stats.frameChanges += bFrameChanged ? 1 : 0;
+            stats.reverts += bRevert ? 1 : 0;
+        }
+
+        Api& api;
+        std::chrono::milliseconds interval;
+        std::chrono::steady_clock::time_point lastApply = {};
+
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        Handle pendingWindow = nullptr;
+        Rect pendingRect;
+        bool bPending = false;
+
+        // Last applied state, to tell the game changing the window back from our own changes
+        Handle appliedWindow = nullptr;
+        State applied;
+        bool bApplied = false;
+        Stats stats;
+    };
+}
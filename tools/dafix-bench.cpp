@@ -0,0 +1,1706 @@
+// DAFix benchmark tool. Runs on the host, no game or Windows required.
+// Build: g++ -std=c++23 -O2 -pthread -Isrc -Iexternal/safetyhook tools/dafix-bench.cpp -o dafix-bench
+// Usage: dafix-bench [image size in MB] [max threads] [--json <file>] [--pe <exe>]...
+//   --json writes the hot path results as JSON so runs can be compared over time.
+//   --pe compares first-byte and profiled anchoring on the code sections of real PE images and checks the disk scan against
+//        a loaded copy of them (repeatable).
+
+#include "arena.hpp"
+#include "asynclog.hpp"
+#include "diskscan.hpp"
+#include "features.hpp"
+#include "framepacer.hpp"
+#include "governor.hpp"
+#include "hooks.hpp"
+#include "hookstats.hpp"
+#include "mappedfile.hpp"
+#include "pagewatch.hpp"
+#include "patch.hpp"
+#include "pe.hpp"
+#include "scanner.hpp"
+#include "signatures.hpp"
+#include "telemetry.hpp"
+#include "window.hpp"
+
+#include <safetyhook.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <sys/mman.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Count heap allocations so each benchmark can report allocations per op.
+// GCC flags free() on memory from operator new even when both are replaced, as they are here.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<std::size_t> gAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace Legacy
+{
+    // Byte-by-byte scanner DAFix shipped before the SIMD scanner, kept as the baseline
+    std::vector<int> pattern_to_byte(const char* pattern)
+    {
+        auto bytes = std::vector<int>{};
+        auto start = const_cast<char*>(pattern);
+        auto end = const_cast<char*>(pattern) + strlen(pattern);
+
+        for (auto current = start; current < end; ++current) {
+            if (*current == '?') {
+                ++current;
+                if (*current == '?')
+                    ++current;
+                bytes.push_back(-1);
+            }
+            else {
+                bytes.push_back(strtoul(current, &current, 16));
+            }
+        }
+        return bytes;
+    }
+
+    const std::uint8_t* PatternScan(const std::uint8_t* scanBytes, std::size_t sizeOfImage, const char* signature)
+    {
+        auto patternBytes = pattern_to_byte(signature);
+        auto s = patternBytes.size();
+        auto d = patternBytes.data();
+
+        for (auto i = 0ul; i < sizeOfImage - s; ++i) {
+            bool found = true;
+            for (auto j = 0ul; j < s; ++j) {
+                if (scanBytes[i + j] != d[j] && d[j] != -1) {
+                    found = false;
+                    break;
+                }
+            }
+            if (found) {
+                return &scanBytes[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // Hook callbacks as they were before Hooks::Select(): one body per hook testing the resolution state and esp on every call
+    template<typename Context>
+    void DialogFOV(Context& ctx, const Hooks::Resolution& resolution)
+    {
+        if (resolution.bWiderThanNative && ctx.esp) {
+            thread_local const Hooks::Resolution* lastResolution = nullptr;
+            thread_local float lastIn = 0.00f;
+            thread_local float lastOut = 0.00f;
+
+            float& fov = *reinterpret_cast<float*>(ctx.esp + 0xC);
+            if (lastResolution != &resolution || lastIn != fov) {
+                lastResolution = &resolution;
+                lastIn = fov;
+                lastOut = atanf(tanf(fov * (Hooks::kPi / 360)) * resolution.fovScale) * (360 / Hooks::kPi);
+            }
+            fov = lastOut;
+        }
+    }
+
+    template<typename Context>
+    void ShadowAspectRatio(Context& ctx, const Hooks::Resolution& resolution)
+    {
+        if (resolution.bWiderThanNative && ctx.esp)
+            *reinterpret_cast<float*>(ctx.esp + 0xC) = Hooks::kNativeAspect;
+    }
+
+    template<typename Context>
+    void DA1_Pillarboxing(Context& ctx, const Hooks::Resolution& resolution)
+    {
+        if (ctx.esp) {
+            *reinterpret_cast<int*>(ctx.esp + 0x0) = 0;
+            *reinterpret_cast<int*>(ctx.esp + 0x4) = 0;
+            *reinterpret_cast<int*>(ctx.esp + 0x8) = resolution.width;
+            *reinterpret_cast<int*>(ctx.esp + 0xC) = resolution.height;
+        }
+    }
+
+    template<typename Context>
+    void DA2_Pillarboxing(Context& ctx, const Hooks::Resolution& resolution)
+    {
+        ctx.ebx = 0;
+        ctx.ebp = 0;
+        ctx.ecx = resolution.width;
+        ctx.edx = resolution.height;
+    }
+
+    template<typename Context>
+    void HUDScale(Context& ctx, const Hooks::Resolution& resolution)
+    {
+        if (ctx.esp && resolution.hudScale != 0.00f)
+            *reinterpret_cast<float*>(ctx.esp + 0x08) = resolution.hudScale;
+    }
+}
+
+// Synthetic image biased towards common x86 opcodes so first-byte candidates are as dense as in a real .text
+std::vector<std::uint8_t> MakeImage(std::size_t size, std::uint32_t seed)
+{
+    static const std::uint8_t kCommon[] = { 0x00, 0x8B, 0x89, 0xFF, 0xD9, 0xE8, 0x83, 0x85, 0x74, 0x75, 0xC3, 0x50, 0x56, 0x57 };
+    std::mt19937 rng(seed);
+    std::vector<std::uint8_t> image(size);
+    for (auto& byte : image) {
+        std::uint32_t r = rng();
+        byte = (r & 1) ? kCommon[(r >> 1) % sizeof(kCommon)] : static_cast<std::uint8_t>(r >> 8);
+    }
+    return image;
+}
+
+// Write a concrete instance of signature at offset (wildcards left as-is)
+void Plant(std::vector<std::uint8_t>& image, std::size_t offset, const char* signature)
+{
+    auto bytes = Legacy::pattern_to_byte(signature);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        if (bytes[i] != -1)
+            image[offset + i] = static_cast<std::uint8_t>(bytes[i]);
+    }
+}
+
+// Hide a value from the optimiser so repeated pure calls aren't folded together
+template<typename T>
+T Opaque(T value)
+{
+    volatile T copy = value;
+    return copy;
+}
+
+template<typename Fn>
+double TimeMs(Fn&& fn, int iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+void BenchScanner(std::size_t imageSize)
+{
+    const char* kSignatures[] = {
+        "D9 ?? ?? ?? D9 ?? ?? ?? ?? ?? 32 ?? 5E 8B ?? 5D C2 ?? ??",
+        "8B ?? 8B ?? ?? ?? ?? ?? 8B ?? FF ?? DC ?? ?? ?? ?? ?? D9 ?? ?? ?? D9 ?? ?? ?? E8 ?? ?? ?? ??",
+        "C7 ?? ?? ?? ?? ?? 00 04 00 00 56 57 E8 ?? ?? ?? ??",
+    };
+
+    auto image = MakeImage(imageSize, 1234);
+    // Plant each signature late in the image so the scan covers most of it
+    for (std::size_t i = 0; i < std::size(kSignatures); ++i)
+        Plant(image, imageSize - imageSize / 16 + i * 4096, kSignatures[i]);
+
+    std::printf("scanner: image %zu bytes, detected level %s\n", imageSize, Scanner::LevelName(Scanner::SupportedLevel()));
+    for (const char* signature : kSignatures) {
+        const std::uint8_t* legacyResult = nullptr;
+        double legacyMs = TimeMs([&] { legacyResult = Legacy::PatternScan(Opaque(image.data()), image.size(), signature); }, 3);
+        std::size_t legacyOffset = legacyResult ? legacyResult - image.data() : 0;
+        std::printf("  %s\n", signature);
+        std::printf("    %-8s %9.3f ms %9.1f MB/s  offset 0x%zx\n", "Legacy", legacyMs, (imageSize / 1e6) / (legacyMs / 1e3), legacyOffset);
+
+        auto pattern = Scanner::ParsePattern(signature);
+        for (auto level : { Scanner::Level::Scalar, Scanner::Level::SSE2, Scanner::Level::AVX2 }) {
+            if (level > Scanner::SupportedLevel())
+                continue;
+            const std::uint8_t* result = nullptr;
+            double ms = TimeMs([&] { result = Scanner::Find(Opaque(image.data()), image.size(), pattern, level); }, 10);
+            std::size_t offset = result ? result - image.data() : 0;
+            std::printf("    %-8s %9.3f ms %9.1f MB/s  offset 0x%zx %s\n", Scanner::LevelName(level), ms, (imageSize / 1e6) / (ms / 1e3), offset,
+                result == legacyResult ? "(match)" : "(MISMATCH)");
+        }
+    }
+}
+
+// Positions whose anchor bytes match (what the SIMD loop stops on), and how many of those pass the filter byte to full verification
+std::pair<std::size_t, std::size_t> CountCandidates(const std::uint8_t* data, std::size_t size, const Scanner::PatternView& pattern)
+{
+    std::size_t candidates = 0;
+    std::size_t filtered = 0;
+    for (std::size_t i = 0; i + pattern.length <= size; ++i) {
+        if (data[i + pattern.anchor] != pattern.bytes[pattern.anchor] || data[i + pattern.anchor2] != pattern.bytes[pattern.anchor2])
+            continue;
+        ++candidates;
+        if (data[i + pattern.filter] == pattern.bytes[pattern.filter])
+            ++filtered;
+    }
+    return { candidates, filtered };
+}
+
+// Every DAFix signature scanned to the end of each code range, first-byte anchoring (Analyse()) against Anchor() on the range's profile.
+// Runs on the synthetic image when no --pe files are given.
+void BenchAnchoring(const std::vector<std::string>& files, std::size_t imageSize)
+{
+    struct Image
+    {
+        std::string name;
+        std::vector<std::pair<const std::uint8_t*, std::size_t>> ranges;
+    };
+
+    std::vector<std::unique_ptr<MappedFile>> mapped;
+    std::vector<Image> images;
+    auto synthetic = MakeImage(imageSize, 2468);
+    for (const auto& path : files) {
+        auto file = std::make_unique<MappedFile>(path);
+        auto layout = *file ? PE::Parse(file->Data(), file->Size()) : std::nullopt;
+        if (!layout) {
+            std::printf("anchoring: %s isn't a readable PE image, skipped\n", path.c_str());
+            continue;
+        }
+        Image image = { path, {} };
+        for (const auto& range : layout->FileRanges(PE::Region::Code, file->Size()))
+            image.ranges.emplace_back(file->Data() + range.offset, range.size);
+        images.push_back(std::move(image));
+        mapped.push_back(std::move(file));
+    }
+    if (images.empty())
+        images.push_back({ "synthetic", { { synthetic.data(), synthetic.size() } } });
+
+    for (const auto& image : images) {
+        std::size_t bytes = 0;
+        for (const auto& [data, size] : image.ranges)
+            bytes += size;
+
+        Scanner::Profile profile;
+        double profileMs = TimeMs([&] {
+            profile = {};
+            for (const auto& [data, size] : image.ranges)
+                profile.Sample(Opaque(data), size);
+        }, 3);
+        std::printf("anchoring: %s, %zu code bytes, sampled profile %.3f ms (%zu bytes)\n", image.name.c_str(), bytes, profileMs, profile.size);
+        std::printf("  %-28s %12s %12s %10s %10s %10s %s\n", "signature", "first-byte", "profiled", "filtered", "first ms", "prof ms", "");
+
+        std::size_t totalFirst = 0;
+        std::size_t totalProfiled = 0;
+        double totalFirstMs = 0.0;
+        double totalProfiledMs = 0.0;
+        bool bAllMatch = true;
+        for (const auto& entry : Signatures::kAll) {
+            Scanner::PatternView first = entry.pattern;
+            Scanner::PatternView profiled = Scanner::Anchor(first, profile);
+
+            std::size_t firstCandidates = 0;
+            std::size_t profiledCandidates = 0;
+            std::size_t filtered = 0;
+            for (const auto& [data, size] : image.ranges) {
+                firstCandidates += CountCandidates(data, size, first).first;
+                auto [candidates, passed] = CountCandidates(data, size, profiled);
+                profiledCandidates += candidates;
+                filtered += passed;
+            }
+
+            auto scanAll = [&](const Scanner::PatternView& pattern) {
+                std::size_t hits = 0;
+                for (const auto& [data, size] : image.ranges) {
+                    const std::uint8_t* end = data + size;
+                    for (const std::uint8_t* current = Opaque(data); current < end; ++current) {
+                        current = Scanner::Find(current, end - current, pattern);
+                        if (!current)
+                            break;
+                        hits = hits * 31 + (current - data) + 1;
+                    }
+                }
+                return hits;
+            };
+            std::size_t firstHits = 0;
+            std::size_t profiledHits = 0;
+            double firstMs = TimeMs([&] { firstHits = scanAll(first); }, 5);
+            double profiledMs = TimeMs([&] { profiledHits = scanAll(profiled); }, 5);
+            bAllMatch &= firstHits == profiledHits;
+
+            totalFirst += firstCandidates;
+            totalProfiled += profiledCandidates;
+            totalFirstMs += firstMs;
+            totalProfiledMs += profiledMs;
+            std::printf("  %-28s %12zu %12zu %10zu %10.3f %10.3f %s\n", entry.name, firstCandidates, profiledCandidates, filtered, firstMs, profiledMs,
+                firstHits == profiledHits ? "(match)" : "(MISMATCH)");
+        }
+        std::printf("  %-28s %12zu %12zu %10s %10.3f %10.3f  %.1fx fewer candidates, %.2fx faster %s\n", "total", totalFirst, totalProfiled, "", totalFirstMs,
+            totalProfiledMs, totalProfiled ? double(totalFirst) / totalProfiled : 0.0, totalFirstMs / totalProfiledMs, bAllMatch ? "(match)" : "(MISMATCH)");
+    }
+}
+
+// GameInit's wait loop (PageWatch) against a full rescan every attempt, on two simulated images:
+// - unpack: pages of a packed image are replaced by the real code in random order, a few hundred per attempt, with the
+//   signature straddling two pages that unpack at different attempts. Both must find it at the same attempt.
+// - late patch: a fully unpacked image completes the signature later by writing one byte outside every sampled line.
+//   The samples can't see it, so the incremental loop must find it at its next full rescan.
+void BenchUnpack(std::size_t imageSize)
+{
+    constexpr std::size_t kSteps = 40;
+    constexpr std::size_t kLateAttempt = 13;
+    constexpr std::size_t kMaxAttempts = 150;
+    using PageWatch::kPageSize;
+
+    const Scanner::PatternView signature = Signatures::GameInit;
+    const std::size_t pages = imageSize / kPageSize;
+    auto unpacked = MakeImage(imageSize, 1357);
+    const std::size_t planted = (pages / 2) * kPageSize - signature.length / 2;
+    Plant(unpacked, planted, signature.text);
+
+    // Late patch target: a line of a page that none of its samples cover
+    auto patched = MakeImage(imageSize, 2468);
+    const std::size_t latePage = pages / 3;
+    auto sampled = [&](std::size_t line) {
+        for (std::size_t sample = 0; sample < PageWatch::kSamples; ++sample) {
+            if (PageWatch::SampleOffset(latePage, sample) == line * PageWatch::kLineSize)
+                return true;
+        }
+        return false;
+    };
+    std::size_t lateLine = 0;
+    while (sampled(lateLine))
+        ++lateLine;
+    const std::size_t late = latePage * kPageSize + lateLine * PageWatch::kLineSize + 8;
+    Plant(patched, late, signature.text);
+    const std::uint8_t lateByte = patched[late];
+    patched[late] = static_cast<std::uint8_t>(~lateByte);
+
+    std::vector<std::uint8_t> packed(imageSize);
+    std::mt19937 rng(97531);
+    for (auto& byte : packed)
+        byte = static_cast<std::uint8_t>(rng());
+    // Anchored on the packed image's profile, as GameInit is: it's all the profile there is before unpacking
+    const Scanner::PatternView pattern = Scanner::Anchor(signature, Scanner::BuildProfile(packed.data(), packed.size()));
+    std::vector<std::size_t> order(pages);
+    for (std::size_t page = 0; page < pages; ++page)
+        order[page] = page;
+    std::shuffle(order.begin(), order.end(), rng);
+
+    struct Run
+    {
+        std::size_t attempt = 0;
+        const std::uint8_t* result = nullptr;
+        double ms = 0.0;
+        std::size_t scanned = 0;
+    };
+    std::vector<std::uint8_t> buffer;
+    // Attempts from the packed image until the signature is found, mutate(attempt) changes the image before each one
+    auto watch = [&](auto&& mutate, bool bIncremental) {
+        Run run;
+        buffer = packed;
+        PageWatch::Tracker tracker;
+        for (std::size_t attempt = 1; attempt <= kMaxAttempts && !run.result; ++attempt) {
+            mutate(attempt);
+            auto start = std::chrono::steady_clock::now();
+            if (!bIncremental) {
+                run.scanned += buffer.size();
+                run.result = Scanner::Find(Opaque(buffer.data()), buffer.size(), pattern);
+            }
+            else if (auto changed = tracker.Update(Opaque(buffer.data()), buffer.size()); PageWatch::FullRescan(static_cast<int>(attempt))) {
+                run.scanned += buffer.size();
+                run.result = Scanner::Find(buffer.data(), buffer.size(), pattern);
+            }
+            else {
+                for (const auto& span : changed)
+                    run.scanned += span.size;
+                run.result = PageWatch::Rescan(buffer.data(), buffer.size(), changed, pattern);
+            }
+            run.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            run.attempt = attempt;
+        }
+        return run;
+    };
+
+    auto unpack = [&](std::size_t attempt) {
+        // Attempt 1 sees the packed image as is, each later one a further batch of pages unpacked
+        const std::size_t batch = pages / kSteps + 1;
+        if (attempt < 2)
+            return;
+        for (std::size_t next = std::min(pages, (attempt - 2) * batch); next < std::min(pages, (attempt - 1) * batch); ++next)
+            std::memcpy(buffer.data() + order[next] * kPageSize, unpacked.data() + order[next] * kPageSize, kPageSize);
+    };
+    auto patch = [&](std::size_t attempt) {
+        if (attempt == 2)
+            std::memcpy(buffer.data(), patched.data(), buffer.size());
+        else if (attempt == kLateAttempt)
+            buffer[late] = lateByte;
+    };
+
+    const double hashedMB = double(pages * PageWatch::kSamples * PageWatch::kLineSize) / 1e6;
+    std::printf("unpack: image %zu bytes, %zu pages, %zu of every %zu bytes hashed per page, full rescan every %d attempts\n", imageSize, pages,
+        PageWatch::kSamples * PageWatch::kLineSize, kPageSize, PageWatch::kFullRescanEvery);
+    auto report = [&](const char* name, const Run& full, const Run& incremental, bool bMatch) {
+        std::printf("  %-12s full        %4zu attempts %9.3f ms %8.3f ms/attempt %9.1f MB scanned\n", name, full.attempt, full.ms, full.ms / full.attempt,
+            full.scanned / 1e6);
+        std::printf("  %-12s incremental %4zu attempts %9.3f ms %8.3f ms/attempt %9.1f MB scanned %7.1f MB hashed  %.2fx faster %s\n", name,
+            incremental.attempt, incremental.ms, incremental.ms / incremental.attempt, incremental.scanned / 1e6, hashedMB * incremental.attempt,
+            (full.ms / full.attempt) / (incremental.ms / incremental.attempt), bMatch ? "(match)" : "(MISMATCH)");
+    };
+
+    Run full = watch(unpack, false);
+    std::size_t fullOffset = full.result ? full.result - buffer.data() : 0;
+    Run incremental = watch(unpack, true);
+    std::size_t incrementalOffset = incremental.result ? incremental.result - buffer.data() : 0;
+    report("unpack", full, incremental, full.result && incremental.result && fullOffset == planted && incrementalOffset == planted && full.attempt == incremental.attempt);
+
+    full = watch(patch, false);
+    fullOffset = full.result ? full.result - buffer.data() : 0;
+    incremental = watch(patch, true);
+    incrementalOffset = incremental.result ? incremental.result - buffer.data() : 0;
+    bool bLate = full.result && incremental.result && fullOffset == late && incrementalOffset == late && full.attempt == kLateAttempt &&
+        PageWatch::FullRescan(static_cast<int>(incremental.attempt)) && incremental.attempt - full.attempt < static_cast<std::size_t>(PageWatch::kFullRescanEvery);
+    report("late patch", full, incremental, bLate);
+}
+
+// Minimal PE32 file: headers, a code section whose file offset differs from its RVA, and a small data section
+std::vector<std::uint8_t> MakePEFile(const std::vector<std::uint8_t>& code)
+{
+    constexpr std::uint32_t kHeaders = 0x400;
+    constexpr std::uint32_t kCodeRva = 0x1000;
+    constexpr std::uint32_t kDataSize = 0x200;
+    const std::uint32_t codeSize = static_cast<std::uint32_t>(code.size());
+    const std::uint32_t dataRva = (kCodeRva + codeSize + 0xFFF) & ~0xFFFu;
+
+    std::vector<std::uint8_t> file(kHeaders + codeSize + kDataSize);
+    auto put16 = [&](std::size_t offset, std::uint16_t value) { std::memcpy(file.data() + offset, &value, sizeof(value)); };
+    auto put32 = [&](std::size_t offset, std::uint32_t value) { std::memcpy(file.data() + offset, &value, sizeof(value)); };
+    put16(0, 0x5A4D);
+    put32(0x3C, 0x40);
+    put32(0x40, 0x00004550);
+    put16(0x44, 0x014C);                    // i386
+    put16(0x46, 2);                         // Sections
+    put32(0x48, 0x4A0F1E2D);                // Timestamp
+    put16(0x54, 0xE0);                      // SizeOfOptionalHeader
+    put16(0x58, 0x10B);                     // PE32
+    put32(0x58 + 28, 0x00400000);           // ImageBase
+    put32(0x58 + 56, dataRva + 0x1000);     // SizeOfImage
+    put32(0x58 + 60, kHeaders);             // SizeOfHeaders
+
+    auto section = [&](std::size_t header, const char* name, std::uint32_t rva, std::uint32_t size, std::uint32_t offset, std::uint32_t characteristics) {
+        std::memcpy(file.data() + header, name, std::strlen(name));
+        put32(header + 8, size);
+        put32(header + 12, rva);
+        put32(header + 16, size);
+        put32(header + 20, offset);
+        put32(header + 36, characteristics);
+    };
+    section(0x138, ".text", kCodeRva, codeSize, kHeaders, PE::kScnCntCode | PE::kScnMemExecute | PE::kScnMemRead);
+    section(0x160, ".data", dataRva, kDataSize, kHeaders + codeSize, PE::kScnCntInitializedData | PE::kScnMemRead | PE::kScnMemWrite);
+    std::memcpy(file.data() + kHeaders, code.data(), codeSize);
+    return file;
+}
+
+// What the loader makes of a PE file: headers and each section's raw data copied to its RVA
+std::vector<std::uint8_t> LoadPE(const std::uint8_t* data, std::size_t size, const PE::Layout& layout)
+{
+    std::vector<std::uint8_t> image(layout.sizeOfImage);
+    std::memcpy(image.data(), data, std::min<std::size_t>({ layout.sizeOfHeaders, size, image.size() }));
+    for (const auto& section : layout.sections) {
+        if (section.rawOffset >= size || section.virtualAddress >= image.size())
+            continue;
+        std::size_t count = std::min<std::size_t>({ section.rawSize, section.MappedSize(), size - section.rawOffset, image.size() - section.virtualAddress });
+        std::memcpy(image.data() + section.virtualAddress, data + section.rawOffset, count);
+    }
+    return image;
+}
+
+// Background disk scan (DiskScan) against scanning the loaded image: every RVA found on disk must be where the in-memory scan
+// finds the signature, and checking those RVAs in place replaces the in-memory scan
+void BenchDiskScan(const std::vector<std::string>& files, std::size_t imageSize)
+{
+    std::vector<std::string> paths = files;
+    std::filesystem::path synthetic;
+    if (paths.empty()) {
+        auto code = MakeImage(imageSize, 8642);
+        std::size_t planted = 0;
+        std::size_t spacing = imageSize / (std::size(Signatures::kAll) + 1);
+        for (const auto& entry : Signatures::kAll)
+            Plant(code, ++planted * spacing + 7, entry.pattern.text);
+        auto bytes = MakePEFile(code);
+        synthetic = std::filesystem::temp_directory_path() / "dafix-bench-disk.exe";
+        std::FILE* out = std::fopen(synthetic.string().c_str(), "wb");
+        bool bWritten = out && std::fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+        if (out)
+            std::fclose(out);
+        if (!bWritten) {
+            std::printf("disk scan: failed to write %s\n", synthetic.string().c_str());
+            return;
+        }
+        paths.push_back(synthetic.string());
+    }
+
+    std::vector<Scanner::PatternView> patterns;
+    for (const auto& entry : Signatures::kAll)
+        patterns.push_back(entry.pattern);
+
+    for (const auto& path : paths) {
+        DiskScan::Prescan prescan;
+        prescan.Start(path, patterns);
+        const DiskScan::Image* disk = prescan.Wait();
+        MappedFile file(path);
+        auto layout = file ? PE::Parse(file.Data(), file.Size()) : std::nullopt;
+        if (!disk || !layout) {
+            std::printf("disk scan: %s isn't a readable PE image, skipped\n", path.c_str());
+            continue;
+        }
+
+        auto image = LoadPE(file.Data(), file.Size(), *layout);
+        auto scanLoaded = [&](Scanner::Batch& batch) {
+            for (const auto& pattern : patterns)
+                batch.Add(pattern);
+            for (const auto& range : layout->ImageRanges(PE::Region::Code))
+                batch.Run(Opaque(image.data()) + range.offset, std::min<std::size_t>(range.size, image.size() - range.offset), 1);
+        };
+        Scanner::Batch loaded;
+        double scanMs = TimeMs([&] { loaded = {}; scanLoaded(loaded); }, 3);
+
+        std::size_t verified = 0;
+        double verifyMs = TimeMs([&] {
+            verified = 0;
+            for (const auto& pattern : patterns) {
+                auto rva = disk->Find(pattern);
+                if (rva && *rva + pattern.size() <= image.size() && Scanner::Matches(Opaque(image.data()) + *rva, pattern))
+                    ++verified;
+            }
+        }, 1000);
+
+        bool bMatch = true;
+        for (const auto& pattern : patterns) {
+            auto rva = disk->Find(pattern);
+            const std::uint8_t* expected = loaded.Result(pattern);
+            bMatch &= rva ? expected == image.data() + *rva : expected == nullptr;
+        }
+        std::printf("disk scan: %s, %zu code bytes on disk, timestamp 0x%08x\n", path.c_str(), disk->scanned, disk->timestamp);
+        std::printf("  %-26s %10.3f ms  %zu/%zu signatures found %s\n", "background scan of file", disk->ms, disk->rvas.size(), patterns.size(),
+            bMatch ? "(match)" : "(MISMATCH)");
+        std::printf("  %-26s %10.3f ms\n", "scan of loaded image", scanMs);
+        std::printf("  %-26s %10.3f ms  %zu verified in place, %.0fx faster\n", "check at disk RVAs", verifyMs, verified, scanMs / verifyMs);
+    }
+    if (!synthetic.empty())
+        std::filesystem::remove(synthetic);
+}
+
+// Speed-up of FindParallel() and Batch::Run() from 1 to N threads on the same image
+void BenchThreads(std::size_t imageSize, std::size_t maxThreads)
+{
+    const char* kSignatures[] = {
+        "8B ?? 8B ?? ?? ?? ?? ?? 8B ?? FF ?? DC ?? ?? ?? ?? ?? D9 ?? ?? ?? D9 ?? ?? ?? E8 ?? ?? ?? ??",
+        "C7 ?? ?? ?? ?? ?? 00 04 00 00 56 57 E8 ?? ?? ?? ??",
+        "D9 ?? ?? ?? D9 ?? ?? ?? ?? ?? 32 ?? 5E 8B ?? 5D C2 ?? ??",
+    };
+
+    auto image = MakeImage(imageSize, 5678);
+    // Last signature near the end so every chunk has to be scanned
+    for (std::size_t i = 0; i < std::size(kSignatures); ++i)
+        Plant(image, imageSize - 4096 + i * 64, kSignatures[i]);
+
+    std::vector<Scanner::Pattern> patterns;
+    for (const char* signature : kSignatures)
+        patterns.push_back(Scanner::ParsePattern(signature));
+
+    if (maxThreads == 0)
+        maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads == 0)
+        maxThreads = 1;
+    if (maxThreads > Scanner::kMaxWorkers)
+        maxThreads = Scanner::kMaxWorkers;
+
+    std::printf("threads: image %zu bytes, up to %zu threads\n", imageSize, maxThreads);
+    std::printf("  %-8s %12s %8s %12s %8s\n", "threads", "find ms", "speedup", "batch ms", "speedup");
+
+    const std::uint8_t* expected = Scanner::Find(image.data(), image.size(), patterns.back());
+    double findBase = 0.0;
+    double batchBase = 0.0;
+    for (std::size_t threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2) {
+        const std::uint8_t* result = nullptr;
+        double findMs = TimeMs([&] { result = Scanner::FindParallel(Opaque(image.data()), image.size(), patterns.back(), threads); }, 10);
+
+        bool bMatch = result == expected;
+        double batchMs = TimeMs([&] {
+            Scanner::Batch batch;
+            for (const auto& pattern : patterns)
+                batch.Add(pattern);
+            batch.Run(Opaque(image.data()), image.size(), threads);
+            bMatch &= batch.Result(patterns.back()) == expected;
+        }, 3);
+
+        if (threads == 1) {
+            findBase = findMs;
+            batchBase = batchMs;
+        }
+        std::printf("  %-8zu %12.3f %7.2fx %12.3f %7.2fx %s\n", threads, findMs, findBase / findMs, batchMs, batchBase / batchMs,
+            bMatch ? "(match)" : "(MISMATCH)");
+        if (threads == maxThreads)
+            break;
+    }
+}
+
+struct Result
+{
+    std::string name;
+    double nsPerOp = 0.0;
+    double bytesPerSec = 0.0;   // 0 when the op doesn't process a buffer
+    double allocsPerOp = 0.0;
+    std::size_t iterations = 0;
+};
+
+// Run fn in growing batches until a batch takes at least minMs, then report the per-op cost of that batch
+template<typename Fn>
+Result Measure(const char* name, std::size_t bytesPerOp, Fn&& fn, double minMs = 100.0)
+{
+    fn();   // Warm up caches and any one-time initialisation
+
+    Result result;
+    result.name = name;
+    for (std::size_t iterations = 1;; iterations *= 2) {
+        std::size_t allocations = gAllocations.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+            fn();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (ns >= minMs * 1e6 || iterations >= (std::size_t(1) << 40)) {
+            result.iterations = iterations;
+            result.nsPerOp = ns / iterations;
+            result.bytesPerSec = bytesPerOp ? bytesPerOp / (result.nsPerOp / 1e9) : 0.0;
+            result.allocsPerOp = double(gAllocations.load(std::memory_order_relaxed) - allocations) / iterations;
+            return result;
+        }
+    }
+}
+
+// A snapshot as the DLL publishes it, with the callbacks selected for it
+Hooks::Resolution SelectedResolution(int width, int height, Hooks::Variant variant, float hudScale = 0.00f)
+{
+    Hooks::Resolution resolution = Hooks::CalculateResolution(width, height, hudScale);
+    resolution.callbacks = Hooks::Select<safetyhook::Context32>(variant, resolution);
+    return resolution;
+}
+
+// Hot paths of the fix: scanning, signature parsing, resolution maths and the mid-hook callback bodies.
+// Windows-only wrappers (VirtualQuery range splitting, SafetyHook trampolines) are left out, their cores run on a synthetic
+// image and on safetyhook::Context32 values pointing at a fake stack.
+std::vector<Result> BenchHotPaths(std::size_t imageSize)
+{
+    std::vector<Result> results;
+
+    auto image = MakeImage(imageSize, 4321);
+    Plant(image, imageSize - imageSize / 8, Signatures::CurrentResolutionB.view.text);
+    for (std::size_t i = 0; i < std::size(Signatures::kAll); ++i)
+        Plant(image, imageSize / 2 + i * 4096, Signatures::kAll[i].pattern.text);
+    const std::uint8_t* data = image.data();
+
+    // Memory::PatternScan / MultiPatternScan: per-range FindParallel(), alternatives tried in order
+    results.push_back(Measure("PatternScan", imageSize, [&] {
+        Opaque(Scanner::FindParallel(Opaque(data), imageSize, Signatures::DA1_ShadowAspectRatio));
+    }));
+    results.push_back(Measure("MultiPatternScan", imageSize, [&] {
+        for (const auto& signature : Signatures::CurrentResolution) {
+            if (Opaque(Scanner::FindParallel(Opaque(data), imageSize, signature)))
+                break;
+        }
+    }));
+    results.push_back(Measure("BatchPatternScan", imageSize, [&] {
+        Scanner::Batch batch;
+        for (const auto& entry : Signatures::kAll)
+            batch.Add(entry.pattern);
+        batch.Run(Opaque(data), imageSize);
+        Opaque(batch.Resolved());
+    }));
+
+    // Hinted search for a signature that moved 3KB since its hint was recorded, against PatternScan above
+    const std::size_t shadowOffset = Scanner::Find(data, imageSize, Signatures::DA1_ShadowAspectRatio) - data;
+    results.push_back(Measure("FindNear", 0, [&] {
+        Opaque(Scanner::FindNear(Opaque(data), imageSize, shadowOffset - 3000, Signatures::DA1_ShadowAspectRatio));
+    }));
+    if (Scanner::FindNear(data, imageSize, shadowOffset - 3000, Signatures::DA1_ShadowAspectRatio) != data + shadowOffset)
+        std::printf("FindNear: (MISMATCH)\n");
+
+    // pattern_to_byte and its replacements
+    const char* signatureText = Signatures::DA1_FoliageDrawDistance.view.text;
+    results.push_back(Measure("pattern_to_byte", 0, [&] { Opaque(Legacy::pattern_to_byte(Opaque(signatureText)).size()); }));
+    results.push_back(Measure("ParsePattern", 0, [&] { Opaque(Scanner::ParsePattern(Opaque(signatureText)).size()); }));
+
+    results.push_back(Measure("CalculateAspectRatio", 0, [&] {
+        Opaque(Hooks::CalculateResolution(Opaque(3440), Opaque(1440)).hudWidthOffset);
+    }));
+    Hooks::ResolutionState state;
+    state.Publish(SelectedResolution(3440, 1440, Hooks::Variant::DA1));
+    results.push_back(Measure("ResolutionState.Load", 0, [&] { Opaque(state.Load().fovScale); }));
+    Hooks::ResolutionState stateDA2;
+    stateDA2.Publish(SelectedResolution(3440, 1440, Hooks::Variant::DA2));
+
+    // Mid-hook callbacks against a fake stack, inputs are reset every op so each call does the same work
+    alignas(16) std::uint8_t stack[64] = {};
+    safetyhook::Context32 ctx = {};
+    ctx.esp = reinterpret_cast<std::uintptr_t>(stack);
+
+    results.push_back(Measure("Hook.DialogFOV", 0, [&] {
+        float fov = 60.0f;
+        std::memcpy(stack + 0xC, &fov, sizeof(fov));
+        Hooks::Call(&Hooks::Callbacks::dialogFOV, ctx, state.Load());
+        Opaque(*reinterpret_cast<float*>(stack + 0xC));
+    }));
+    results.push_back(Measure("Hook.ShadowAspectRatio", 0, [&] {
+        Hooks::Call(&Hooks::Callbacks::shadowAspectRatio, ctx, state.Load());
+        Opaque(*reinterpret_cast<float*>(stack + 0xC));
+    }));
+    results.push_back(Measure("Hook.HUDScale", 0, [&] {
+        Hooks::Call(&Hooks::Callbacks::hudScale, ctx, state.Load());
+        Opaque(*reinterpret_cast<float*>(stack + 0x8));
+    }));
+    results.push_back(Measure("Hook.DA1_Pillarboxing", 0, [&] {
+        Hooks::Call(&Hooks::Callbacks::pillarboxing, ctx, state.Load());
+        Opaque(*reinterpret_cast<int*>(stack + 0x8));
+    }));
+    results.push_back(Measure("Hook.DA2_Pillarboxing", 0, [&] {
+        Hooks::Call(&Hooks::Callbacks::pillarboxing, ctx, stateDA2.Load());
+        Opaque(ctx.ecx);
+    }));
+
+    // Cost HOOK_STATS_SCOPE() adds to every hook call when DAFIX_HOOK_STATS is defined
+    HookStats::Registry registry;
+    HookStats::Hook& statsHook = registry.Register("Bench");
+    results.push_back(Measure("HookStats.Scope", 0, [&] { HookStats::Scope scope(statsHook); }));
+
+    std::printf("hot paths: image %zu bytes\n", imageSize);
+    std::printf("  %-24s %14s %12s %10s\n", "name", "ns/op", "MB/s", "allocs/op");
+    for (const auto& result : results) {
+        std::printf("  %-24s %14.1f %12.1f %10.2f\n", result.name.c_str(), result.nsPerOp, result.bytesPerSec / 1e6, result.allocsPerOp);
+    }
+    return results;
+}
+
+bool WriteJson(const char* path, const std::vector<Result>& results, std::size_t imageSize)
+{
+    FILE* file = std::fopen(path, "w");
+    if (!file)
+        return false;
+    std::fprintf(file, "{\n  \"image_size\": %zu,\n  \"scanner_level\": \"%s\",\n  \"hardware_threads\": %u,\n  \"results\": [\n", imageSize,
+        Scanner::LevelName(Scanner::SupportedLevel()), std::thread::hardware_concurrency());
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        std::fprintf(file, "    { \"name\": \"%s\", \"ns_per_op\": %.3f, \"bytes_per_sec\": %.1f, \"allocs_per_op\": %.3f, \"iterations\": %zu }%s\n",
+            result.name.c_str(), result.nsPerOp, result.bytesPerSec, result.allocsPerOp, result.iterations, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+
+// Hook callbacks selected per snapshot against the branching bodies they replaced, at resolutions where every fix applies,
+// where the FOV and shadow fixes don't (16:9) and where the HUD scale doesn't either (1024x768). Each pair must leave the
+// same registers and stack behind.
+void BenchCallbacks()
+{
+    struct Mode
+    {
+        int width;
+        int height;
+    };
+    constexpr Mode kModes[] = { { 3440, 1440 }, { 1920, 1080 }, { 1024, 768 } };
+
+    using Context = safetyhook::Context32;
+    using Legacy = void (*)(Context&, const Hooks::Resolution&);
+    struct Hook
+    {
+        const char* name;
+        Hooks::Variant variant;
+        Hooks::Callback Hooks::Callbacks::*callback;
+        Legacy legacy;
+    };
+    const Hook kHooks[] = {
+        { "DialogFOV", Hooks::Variant::DA1, &Hooks::Callbacks::dialogFOV, Legacy::DialogFOV<Context> },
+        { "ShadowAspectRatio", Hooks::Variant::DA1, &Hooks::Callbacks::shadowAspectRatio, Legacy::ShadowAspectRatio<Context> },
+        { "DA1_Pillarboxing", Hooks::Variant::DA1, &Hooks::Callbacks::pillarboxing, Legacy::DA1_Pillarboxing<Context> },
+        { "DA2_Pillarboxing", Hooks::Variant::DA2, &Hooks::Callbacks::pillarboxing, Legacy::DA2_Pillarboxing<Context> },
+        { "HUDScale", Hooks::Variant::DA1, &Hooks::Callbacks::hudScale, Legacy::HUDScale<Context> },
+    };
+
+    std::printf("hook callbacks: branching vs selected per snapshot\n");
+    std::printf("  %-11s %-18s %12s %12s\n", "resolution", "hook", "branching", "selected");
+    for (const auto& mode : kModes) {
+        Hooks::ResolutionState states[2];
+        states[0].Publish(SelectedResolution(mode.width, mode.height, Hooks::Variant::DA1));
+        states[1].Publish(SelectedResolution(mode.width, mode.height, Hooks::Variant::DA2));
+
+        for (const auto& hook : kHooks) {
+            const Hooks::ResolutionState& state = states[hook.variant == Hooks::Variant::DA2 ? 1 : 0];
+            // Same inputs for both: whatever the game left on the stack, a 60 degree FOV and a HUD scale of 1
+            alignas(16) std::uint8_t input[16];
+            std::memset(input, 0xCC, sizeof(input));
+            float fov = 60.0f;
+            float scale = 1.0f;
+            std::memcpy(input + 0x8, &scale, sizeof(scale));
+            std::memcpy(input + 0xC, &fov, sizeof(fov));
+            alignas(16) std::uint8_t stacks[2][16];
+            Context contexts[2] = {};
+            auto reset = [&](std::size_t i) {
+                std::memcpy(stacks[i], input, sizeof(input));
+                contexts[i].ebx = contexts[i].ebp = contexts[i].ecx = contexts[i].edx = 0xCCCC'CCCC;
+                contexts[i].esp = reinterpret_cast<std::uintptr_t>(stacks[i]);
+            };
+
+            reset(0);
+            reset(1);
+            hook.legacy(contexts[0], state.Load());
+            Hooks::Call(hook.callback, contexts[1], state.Load());
+            bool bMatch = std::memcmp(stacks[0], stacks[1], sizeof(stacks[0])) == 0 && contexts[0].ebx == contexts[1].ebx &&
+                contexts[0].ebp == contexts[1].ebp && contexts[0].ecx == contexts[1].ecx && contexts[0].edx == contexts[1].edx;
+
+            // Inputs are restored before every call, as in BenchHotPaths, so each call does the same work as the first.
+            // Batches of calls keep the clock reads out of the per-call figure.
+            constexpr std::size_t kBatch = 64;
+            Result branching = Measure("branching", 0, [&] {
+                for (std::size_t call = 0; call < kBatch; ++call) {
+                    reset(0);
+                    hook.legacy(Opaque(&contexts[0])[0], state.Load());
+                }
+                Opaque(stacks[0][0xC]);
+            }, 50.0);
+            Result selected = Measure("selected", 0, [&] {
+                for (std::size_t call = 0; call < kBatch; ++call) {
+                    reset(1);
+                    Hooks::Call(hook.callback, Opaque(&contexts[1])[0], state.Load());
+                }
+                Opaque(stacks[1][0xC]);
+            }, 50.0);
+            branching.nsPerOp /= kBatch;
+            selected.nsPerOp /= kBatch;
+            char resolution[16];
+            std::snprintf(resolution, sizeof(resolution), "%dx%d", mode.width, mode.height);
+            std::printf("  %-11s %-18s %9.2f ns %9.2f ns %s\n", resolution, hook.name, branching.nsPerOp, selected.nsPerOp, bMatch ? "(match)" : "(MISMATCH)");
+        }
+    }
+}
+
+// Drive the hook stats aggregation with synthetic calls from several threads and check nothing is lost in the merge
+void BenchHookStats()
+{
+    constexpr std::size_t kThreads = 4;
+    constexpr std::size_t kCalls = 200000;
+
+    HookStats::Registry registry;
+    HookStats::Hook& fast = registry.Register("Synthetic.Fast");
+    HookStats::Hook& slow = registry.Register("Synthetic.Slow");
+    registry.Collect();
+
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&] {
+            for (std::size_t i = 0; i < kCalls; ++i) {
+                {
+                    HookStats::Scope scope(fast);
+                }
+                if (i % 100 == 0) {
+                    HookStats::Scope scope(slow);
+                    volatile float sink = 1.0f;
+                    for (int j = 0; j < 1000; ++j)
+                        sink = sink * 1.0001f;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    std::printf("hook stats: %zu threads x %zu calls\n", kThreads, kCalls);
+    for (const auto& summary : registry.Collect()) {
+        std::uint64_t expected = summary.name == std::string("Synthetic.Fast") ? kThreads * kCalls : kThreads * (kCalls / 100);
+        std::printf("  %-16s %9llu calls %12.0f/s  mean %8.1f ns  p50 <%8.0f ns  p99 <%8.0f ns %s\n", summary.name,
+            static_cast<unsigned long long>(summary.calls), summary.callsPerSec, summary.meanNs, summary.p50Ns, summary.p99Ns,
+            summary.calls == expected ? "(match)" : "(MISMATCH)");
+    }
+}
+
+// Deferred binary logging against formatting and flushing every line on the calling thread (the old basic_logger_st + flush_on(debug))
+void BenchAsyncLog()
+{
+    constexpr std::size_t kThreads = 2;
+    constexpr std::size_t kLines = 20000;
+
+    // Decoder output must match what fmt would print
+    struct Case
+    {
+        std::string decoded;
+        const char* expected;
+    };
+    auto decode = [](std::uint16_t format, auto... args) {
+        AsyncLog::Record record;
+        record.format = format;
+        (AsyncLog::Detail::Encode(record, args), ...);
+        return AsyncLog::Decode(record);
+    };
+    Case cases[] = {
+        { decode(AsyncLog::Formats::Register(AsyncLog::Level::Info, "Resolution: {:d}x{:d}"), 3440, 1440), "Resolution: 3440x1440" },
+        { decode(AsyncLog::Formats::Register(AsyncLog::Level::Info, "Aspect Ratio: {}"), 3440.0f / 1440.0f), "Aspect Ratio: 2.3888888" },
+        { decode(AsyncLog::Formats::Register(AsyncLog::Level::Info, "{:s}+{:x} {:.2f}ms {{ok}}"), "DAOrigins.exe", 0x1a2bU, 1.005), "DAOrigins.exe+1a2b 1.00ms {ok}" },
+    };
+    std::printf("async log: decoder\n");
+    for (const auto& c : cases)
+        std::printf("  %-40s %s\n", c.decoded.c_str(), c.decoded == c.expected ? "(match)" : "(MISMATCH)");
+
+    FILE* file = std::tmpfile();
+    if (!file)
+        return;
+    std::uint16_t format = AsyncLog::Formats::Register(AsyncLog::Level::Info, "Current Resolution: Resolution: {:d}x{:d}, Aspect Ratio: {}");
+
+    auto run = [&](auto&& logLine) {
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&] {
+                for (std::size_t i = 0; i < kLines; ++i)
+                    logLine(static_cast<int>(i));
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (kThreads * kLines);
+    };
+
+    // Synchronous: format + write + flush under a lock on the calling thread
+    std::mutex mutex;
+    double syncNs = run([&](int i) {
+        char line[128];
+        int length = std::snprintf(line, sizeof(line), "Current Resolution: Resolution: %dx%d, Aspect Ratio: %g\n", i, 1440, i / 1440.0f);
+        std::lock_guard lock(mutex);
+        std::fwrite(line, 1, length, file);
+        std::fflush(file);
+    });
+
+    // Deferred: callers only push records, the background thread decodes and writes. Callers wait for it to drain the ring
+    // between batches that fit in it, so every push succeeds and only the pushes are timed.
+    constexpr std::size_t kBatch = AsyncLog::kRingSize / kThreads;
+    std::atomic<std::size_t> written = 0;
+    AsyncLog::Logger logger;
+    AsyncLog::Sink sink = {
+        [&](AsyncLog::Level level, std::int64_t, std::string_view message) {
+            if (level == AsyncLog::Level::Warn)
+                return;
+            std::fwrite(message.data(), 1, message.size(), file);
+            std::fputc('\n', file);
+            ++written;
+        },
+        [&] { std::fflush(file); }
+    };
+    logger.Start(sink, std::chrono::milliseconds(1));
+    std::array<double, kThreads> pushNs = {};
+    {
+        std::barrier sync(kThreads + 1);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&, t] {
+                for (std::size_t line = 0; line < kLines; line += kBatch) {
+                    sync.arrive_and_wait();
+                    auto start = std::chrono::steady_clock::now();
+                    for (std::size_t i = line; i < std::min(line + kBatch, kLines); ++i)
+                        logger.Log(format, "", static_cast<int>(i), 1440, i / 1440.0f);
+                    pushNs[t] += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                    sync.arrive_and_wait();
+                }
+            });
+        }
+        for (std::size_t line = 0; line < kLines; line += kBatch) {
+            sync.arrive_and_wait();
+            sync.arrive_and_wait();
+            std::size_t expected = kThreads * std::min(line + kBatch, kLines);
+            while (written.load() < expected && logger.Dropped() == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        for (auto& thread : threads)
+            thread.join();
+    }
+    double asyncNs = 0.0;
+    for (double ns : pushNs)
+        asyncNs += ns;
+    asyncNs /= kThreads * kLines;
+    std::size_t asyncDropped = logger.Dropped();
+
+    std::size_t asyncWritten = written;
+
+    // Burst: the same lines without waiting, how many the background thread can't keep up with and what a push costs then
+    double burstNs = run([&](int i) { logger.Log(format, "", i, 1440, i / 1440.0f); });
+    logger.Stop();
+    std::size_t burstWritten = written - asyncWritten;
+    std::size_t burstDropped = logger.Dropped() - asyncDropped;
+
+    // Table full: registration returns kNoFormat and the line is written synchronously through the sink
+    std::size_t before = written;
+    std::uint16_t full = 0;
+    for (std::size_t i = 0; i <= AsyncLog::kMaxFormats && full != AsyncLog::kNoFormat; ++i)
+        full = AsyncLog::Formats::Register(AsyncLog::Level::Info, "Table full: {:d}");
+    logger.LogNow(AsyncLog::Level::Info, "Table full: {:d}", 42);
+    bool bFallback = full == AsyncLog::kNoFormat && written == before + 1;
+    std::fclose(file);
+
+    std::printf("async log: %zu threads x %zu lines\n", kThreads, kLines);
+    std::printf("  %-12s %10.1f ns/line on the calling thread\n", "sync", syncNs);
+    std::printf("  %-12s %10.1f ns/push on the calling thread, ring drained every %zu lines, %zu written, %zu dropped %s\n", "async", asyncNs,
+        kBatch * kThreads, asyncWritten, asyncDropped, asyncDropped == 0 && asyncWritten == kThreads * kLines ? "(match)" : "(MISMATCH)");
+    std::printf("  %-12s %10.1f ns/push without waiting, %zu written, %zu dropped (%.1f%%) %s\n", "async burst", burstNs, burstWritten, burstDropped,
+        100.0 * burstDropped / (kThreads * kLines), burstWritten + burstDropped == kThreads * kLines ? "(match)" : "(MISMATCH)");
+    std::printf("  %-12s %s\n", "table full", bFallback ? "logged synchronously (match)" : "(MISMATCH)");
+}
+
+// Drives the draw distance governor with a simulated trace: frame time = base + load * scale, plus noise.
+// Reports where each phase settles and how often the scale changes direction, against an unsmoothed controller with no deadband.
+void BenchGovernor()
+{
+    struct Phase
+    {
+        const char* name;
+        double baseMs;
+        double loadMs;      // Cost of full draw distance
+        int intervals;
+    };
+    constexpr Phase kPhases[] = {
+        { "calm", 9.0, 8.0, 60 },
+        { "crowded", 12.0, 14.0, 120 },
+        { "calm", 9.0, 8.0, 120 },
+    };
+
+    // FrameTimer: 1000 frames of 16ms plus one alt-tab gap that must be ignored
+    Governor::FrameTimer timer;
+    std::int64_t now = 1;
+    for (int i = 0; i < 1000; ++i)
+        timer.Present(now += 16'000'000);
+    timer.Present(now += 2'000'000'000);
+    double meanMs = timer.TakeMeanMs();
+    std::printf("governor: frame timer mean %.3f ms %s\n", meanMs, meanMs == 16.0 && timer.TakeMeanMs() == 0.0 ? "(match)" : "(MISMATCH)");
+
+    auto run = [&](const char* label, const Governor::Settings& settings) {
+        std::mt19937 rng(99);
+        std::uniform_real_distribution<double> noise(0.85, 1.15);
+        Governor::Controller controller(settings);
+        int reversals = 0;
+        int lastDirection = 0;
+        std::printf("  %-12s", label);
+        for (const auto& phase : kPhases) {
+            double totalMs = 0.0;
+            for (int i = 0; i < phase.intervals; ++i) {
+                double frameMs = (phase.baseMs + phase.loadMs * controller.Scale()) * noise(rng);
+                totalMs += frameMs;
+                float previous = controller.Scale();
+                if (controller.Update(frameMs)) {
+                    int direction = controller.Scale() > previous ? 1 : -1;
+                    reversals += lastDirection && direction != lastDirection;
+                    lastDirection = direction;
+                }
+            }
+            std::printf(" %s %.2f (%.1f ms)", phase.name, controller.Scale(), totalMs / phase.intervals);
+        }
+        std::printf(", %d reversals\n", reversals);
+        return reversals;
+    };
+
+    Governor::Settings settings;
+    Governor::Settings naive = settings;
+    naive.deadband = 0.00f;
+    naive.smoothing = 1.00f;
+    naive.stepUp = naive.stepDown;
+    std::printf("governor: target %.1f ms\n", settings.targetFrameMs);
+    int governed = run("governor", settings);
+    int unsmoothed = run("naive", naive);
+    std::printf("  %s\n", governed < unsmoothed ? "fewer reversals (match)" : "(MISMATCH)");
+}
+
+// Counts protection changes and can fail the nth Unprotect, on top of the real mprotect layer
+struct CountingProtect : Patch::Protect::Native
+{
+    static inline std::size_t unprotects = 0;
+    static inline std::size_t restores = 0;
+    static inline std::size_t failAt = 0;   // 1-based, 0 never fails
+
+    static bool Unprotect(std::uint8_t* page, std::uint32_t& old)
+    {
+        if (++unprotects == failAt)
+            return false;
+        return Patch::Protect::Native::Unprotect(page, old);
+    }
+
+    static bool Restore(std::uint8_t* page, std::uint32_t old)
+    {
+        ++restores;
+        return Patch::Protect::Native::Restore(page, old);
+    }
+};
+
+// Page-coalesced patch transactions against one protect/unprotect pair per write, plus per-group rollback on failure
+void BenchPatch()
+{
+    constexpr std::size_t kPages = 4;
+    constexpr std::size_t kWrites = 64;
+    const std::size_t pageSize = Patch::Protect::Native::PageSize();
+    void* mapping = mmap(nullptr, kPages * pageSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+        return;
+    auto* memory = static_cast<std::uint8_t*>(mapping);
+
+    // Writes spread over the first two pages, one of them straddling the boundary
+    auto queue = [&](Patch::Transaction<CountingProtect>& patch, std::uint32_t value) {
+        for (std::size_t i = 0; i < kWrites; ++i)
+            patch.Write(memory + (i * 2 * pageSize) / kWrites, value + static_cast<std::uint32_t>(i));
+        patch.Write(memory + pageSize - 2, value);
+    };
+    auto readOnly = [&] {
+        std::uint32_t protection = 0;
+        for (std::size_t page = 0; page < kPages; ++page) {
+            if (!Patch::Protect::Native::Query(memory + page * pageSize, protection) || protection != PROT_READ)
+                return false;
+        }
+        return true;
+    };
+    auto reset = [] { CountingProtect::unprotects = CountingProtect::restores = CountingProtect::failAt = 0; };
+
+    std::printf("patch: %zu writes over 2 of %zu pages\n", kWrites + 1, kPages);
+
+    reset();
+    double legacyMs = TimeMs([&] {
+        for (std::size_t i = 0; i < kWrites; ++i) {
+            Patch::Transaction<CountingProtect> single;
+            single.Write(memory + (i * 2 * pageSize) / kWrites, std::uint32_t(0));
+            single.Commit();
+        }
+    }, 1);
+    std::printf("  %-12s %8zu protection changes %10.3f ms\n", "per write", CountingProtect::unprotects + CountingProtect::restores, legacyMs);
+
+    reset();
+    int installed = 0;
+    Patch::Transaction<CountingProtect> patch;
+    queue(patch, 100);
+    patch.Step([&] { ++installed; return true; }, [&] { --installed; });
+    bool bCommitted = false;
+    double batchMs = TimeMs([&] { bCommitted = patch.Commit()[0]; }, 1);
+    bool bWritten = *reinterpret_cast<std::uint32_t*>(memory + (2 * pageSize) / kWrites) == 101;
+    std::printf("  %-12s %8zu protection changes %10.3f ms %s\n", "transaction", CountingProtect::unprotects + CountingProtect::restores, batchMs,
+        bCommitted && bWritten && installed == 1 && CountingProtect::unprotects == 2 && readOnly() ? "(match)" : "(MISMATCH)");
+
+    // A failing step undoes the steps before it and never touches memory
+    reset();
+    std::vector<std::uint8_t> before(memory, memory + 2 * pageSize);
+    Patch::Transaction<CountingProtect> failingStep;
+    queue(failingStep, 200);
+    failingStep.Step([&] { ++installed; return true; }, [&] { --installed; });
+    failingStep.Step([] { return false; }, [] {});
+    bool bRolledBack = !failingStep.Commit()[0] && installed == 1 && std::memcmp(before.data(), memory, before.size()) == 0 && CountingProtect::unprotects == 0;
+    std::printf("  %-12s %s\n", "step fails", bRolledBack ? "rolled back (match)" : "(MISMATCH)");
+
+    // Failing to unprotect the second page restores the first and undoes the steps
+    reset();
+    CountingProtect::failAt = 2;
+    Patch::Transaction<CountingProtect> failingPage;
+    queue(failingPage, 300);
+    failingPage.Step([&] { ++installed; return true; }, [&] { --installed; });
+    bRolledBack = !failingPage.Commit()[0] && installed == 1 && std::memcmp(before.data(), memory, before.size()) == 0 && CountingProtect::restores == 1 && readOnly();
+    std::printf("  %-12s %s\n", "page fails", bRolledBack ? "rolled back (match)" : "(MISMATCH)");
+
+    // Groups are independent: a failing step and a failing page each roll back only their own group
+    reset();
+    installed = 0;
+    std::vector<std::uint8_t> untouched(memory + 2 * pageSize, memory + 4 * pageSize);
+    Patch::Transaction<CountingProtect> groups;
+    queue(groups, 400);
+    groups.Step([&] { ++installed; return true; }, [&] { --installed; });
+    groups.Group();
+    groups.Write(memory + 2 * pageSize, std::uint32_t(500));
+    groups.Step([&] { ++installed; return true; }, [&] { --installed; });
+    groups.Step([] { return false; }, [] {});
+    groups.Group();
+    groups.Write(memory + 3 * pageSize, std::uint32_t(600));
+    groups.Step([&] { ++installed; return true; }, [&] { --installed; });
+    CountingProtect::failAt = 3;
+    std::vector<bool> applied = groups.Commit();
+    bool bIsolated = applied == std::vector<bool>{ true, false, false } && installed == 1 && *reinterpret_cast<std::uint32_t*>(memory + (2 * pageSize) / kWrites) == 401 &&
+        std::memcmp(untouched.data(), memory + 2 * pageSize, untouched.size()) == 0 && CountingProtect::restores == 2 && readOnly();
+    std::printf("  %-12s %s\n", "group fails", bIsolated ? "others applied (match)" : "(MISMATCH)");
+
+    munmap(mapping, kPages * pageSize);
+}
+
+// Refuses the first refusals placement probes, as if the pages next to the module were taken
+struct BusyPages : Arena::Pages::Native
+{
+    static inline std::size_t refusals = 0;
+    static inline std::size_t probes = 0;
+
+    static std::uint8_t* Reserve(std::uint8_t* address, std::size_t size)
+    {
+        if (++probes <= refusals)
+            return nullptr;
+        return Arena::Pages::Native::Reserve(address, size);
+    }
+};
+
+// Hook arena: placement next to a module, cache line packing of hook-sized blocks, and calls through packed stubs against
+// the same stubs one per page (as separate near allocations give)
+void BenchArena()
+{
+    constexpr std::size_t kModuleSize = 16 * 1024 * 1024;
+    constexpr std::size_t kStubSizes[] = { 37, 52, 24, 90, 41, 18, 64, 33, 75, 29, 46, 58 };
+    constexpr std::size_t kStubs = std::size(kStubSizes);
+    const std::size_t pageSize = Arena::Pages::Native::Granularity();
+
+    // A stand-in module, with room left around it for the arena
+    void* mapping = mmap(nullptr, kModuleSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+        return;
+    auto* module = static_cast<std::uint8_t*>(mapping);
+    auto distance = [](const std::uint8_t* a, const std::uint8_t* b) { return static_cast<std::size_t>(a > b ? a - b : b - a); };
+
+    std::printf("arena: %zu stubs near a %zu MB module\n", kStubs, kModuleSize / (1024 * 1024));
+    Arena::Arena<BusyPages> arena;
+    BusyPages::refusals = 5;
+    bool bPlaced = arena.Reserve(module, module + kModuleSize, 0x10000);
+    bool bReachable = bPlaced && distance(arena.Base() + arena.Capacity(), module) <= Arena::kRel32 && distance(module + kModuleSize, arena.Base()) <= Arena::kRel32;
+    std::printf("  %-22s %s at module%+lld after %zu probes %s\n", "placement", bPlaced ? "reserved" : "failed",
+        bPlaced ? static_cast<long long>(arena.Base() - module) : 0LL, arena.Attempts(), bReachable && arena.Attempts() > BusyPages::refusals ? "(match)" : "(MISMATCH)");
+
+    // Nothing free within reach: Reserve gives up instead of placing it where a rel32 jmp can't get to
+    Arena::Arena<BusyPages> unreachable;
+    BusyPages::probes = 0;
+    BusyPages::refusals = std::size_t(-1);
+    bool bRefused = !unreachable.Reserve(module, module + kModuleSize, 0x10000, kModuleSize + 0x40000);
+    std::printf("  %-22s %zu probes, %s\n", "no room in reach", unreachable.Attempts(), bRefused && unreachable.Attempts() == BusyPages::probes && BusyPages::probes > 0 ? "refused (match)" : "(MISMATCH)");
+    BusyPages::refusals = 0;
+
+    std::vector<std::uint8_t*> packed;
+    std::size_t requested = 0;
+    bool bAligned = true;
+    for (std::size_t i = 0; i < kStubs; ++i) {
+        std::uint8_t* block = arena.Allocate("stub" + std::to_string(i), kStubSizes[i]);
+        bAligned &= block && reinterpret_cast<std::uintptr_t>(block) % Arena::kCacheLine == 0;
+        requested += kStubSizes[i];
+        packed.push_back(block);
+    }
+    bool bOverlap = false;
+    for (std::size_t i = 1; i < arena.Blocks().size(); ++i)
+        bOverlap |= arena.Blocks()[i].offset < arena.Blocks()[i - 1].offset + arena.Blocks()[i - 1].size;
+    bool bFull = arena.Allocate("too big", arena.Capacity()) == nullptr;
+    std::printf("  %-22s %zu bytes in %zu bytes, %zu lines, %zu page(s) %s\n", "packed", requested, arena.Used(),
+        (arena.Used() + Arena::kCacheLine - 1) / Arena::kCacheLine, (arena.Used() + pageSize - 1) / pageSize,
+        bAligned && !bOverlap && bFull ? "(match)" : "(MISMATCH)");
+
+    // Same stubs one per page, spaced like separate allocations: each a run of nops ending in ret
+    std::vector<void*> mappings;
+    std::vector<std::uint8_t*> scattered;
+    for (std::size_t i = 0; i < kStubs; ++i) {
+        void* pages = mmap(nullptr, pageSize * 16, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (pages != MAP_FAILED)
+            mappings.push_back(pages);
+        scattered.push_back(pages == MAP_FAILED ? nullptr : static_cast<std::uint8_t*>(pages) + (i * 7 % 16) * pageSize);
+    }
+    bool bStubs = std::all_of(packed.begin(), packed.end(), [](auto* p) { return p; }) && std::all_of(scattered.begin(), scattered.end(), [](auto* p) { return p; });
+    if (bStubs) {
+        for (std::size_t i = 0; i < kStubs; ++i) {
+            for (auto* stub : { packed[i], scattered[i] }) {
+                std::memset(stub, 0x90, kStubSizes[i] - 1);
+                stub[kStubSizes[i] - 1] = 0xC3;
+            }
+        }
+        auto callAll = [&](const std::vector<std::uint8_t*>& stubs) {
+            for (int round = 0; round < 100000; ++round) {
+                for (auto* stub : stubs)
+                    reinterpret_cast<void (*)()>(Opaque(stub))();
+            }
+        };
+        double packedMs = TimeMs([&] { callAll(packed); }, 5);
+        double scatteredMs = TimeMs([&] { callAll(scattered); }, 5);
+        double calls = 100000.0 * kStubs;
+        std::printf("  %-22s %8.2f ns/call packed %8.2f ns/call scattered  %.2fx\n", "calls", packedMs * 1e6 / calls, scatteredMs * 1e6 / calls, scatteredMs / packedMs);
+    }
+    for (void* pages : mappings)
+        munmap(pages, pageSize * 16);
+
+    // One release frees the whole arena, its address can be mapped again
+    std::uint8_t* base = arena.Base();
+    std::size_t capacity = arena.Capacity();
+    arena.Release();
+    std::uint8_t* again = Arena::Pages::Native::Reserve(base, capacity);
+    std::printf("  %-22s %s\n", "release", again == base && arena.Blocks().empty() ? "unmapped in one call (match)" : "(MISMATCH)");
+    if (again)
+        Arena::Pages::Native::Release(again, capacity);
+    munmap(mapping, kModuleSize);
+}
+
+// A window the game keeps resetting: counts each kind of call the way DWM pays for them
+struct MockWindow
+{
+    Window::State state = { 0x14CF0000, 0x00000300, { 100, 100, 1280, 720 } };  // WS_OVERLAPPEDWINDOW-ish
+    std::atomic<std::uint64_t> reads = 0;
+    std::atomic<std::uint64_t> styleWrites = 0;
+    std::atomic<std::uint64_t> placements = 0;
+    std::atomic<std::uint64_t> frameChanges = 0;
+    std::mutex mutex;
+
+    Window::State Read(Window::Handle)
+    {
+        std::lock_guard lock(mutex);
+        ++reads;
+        return state;
+    }
+
+    void SetStyle(Window::Handle, std::uint32_t style)
+    {
+        std::lock_guard lock(mutex);
+        ++styleWrites;
+        state.style = style;
+    }
+
+    void SetExStyle(Window::Handle, std::uint32_t exStyle)
+    {
+        std::lock_guard lock(mutex);
+        ++styleWrites;
+        state.exStyle = exStyle;
+    }
+
+    void Place(Window::Handle, const Window::Rect& rect, bool bFrameChanged)
+    {
+        std::lock_guard lock(mutex);
+        ++placements;
+        frameChanges += bFrameChanged ? 1 : 0;
+        state.rect = rect;
+    }
+
+    // What the game does on alt-tab or a mode change: frame back on, window moved
+    void Reset(const Window::Rect& rect)
+    {
+        std::lock_guard lock(mutex);
+        state.style |= 0x00C00000 | 0x00040000;
+        state.exStyle |= 0x00000200;
+        state.rect = rect;
+    }
+
+    bool IsBorderless(const Window::Rect& rect)
+    {
+        std::lock_guard lock(mutex);
+        return !(state.style & Window::kBorderStyle) && !(state.exStyle & Window::kBorderExStyle) && state.rect == rect;
+    }
+};
+
+// Borderless hook fired on every pass of the hooked code, with the game resetting its window now and then.
+// The old hook made every call every time, the reconciler only the ones that change the window.
+void BenchWindow()
+{
+    constexpr int kCalls = 1000;
+    constexpr int kResetEvery = 100;
+    const Window::Handle window = reinterpret_cast<Window::Handle>(0x1234);
+    const Window::Rect desktop = { 0, 0, 2560, 1440 };
+
+    std::printf("window: borderless hook fired %d times, game resets the window every %d\n", kCalls, kResetEvery);
+
+    // Old hook: two reads, two style writes and a SWP_FRAMECHANGED placement per call
+    MockWindow legacy;
+    for (int call = 0; call < kCalls; ++call) {
+        if (call % kResetEvery == 0)
+            legacy.Reset({ 100, 100, 1280, 720 });
+        Window::State state = legacy.Read(window);
+        legacy.SetStyle(window, state.style & ~Window::kBorderStyle);
+        legacy.SetExStyle(window, state.exStyle & ~Window::kBorderExStyle);
+        legacy.Place(window, desktop, true);
+    }
+    std::printf("  %-14s %6llu style writes %6llu placements %6llu frame changes\n", "every call", static_cast<unsigned long long>(legacy.styleWrites.load()),
+        static_cast<unsigned long long>(legacy.placements.load()), static_cast<unsigned long long>(legacy.frameChanges.load()));
+
+    // Reconciler applying each request straight away: only resets cost anything
+    MockWindow mock;
+    Window::Reconciler<MockWindow> reconciler(mock, std::chrono::milliseconds(0));
+    bool bBorderless = true;
+    for (int call = 0; call < kCalls; ++call) {
+        if (call % kResetEvery == 0)
+            mock.Reset({ 100, 100, 1280, 720 });
+        reconciler.Request(window, desktop);
+        reconciler.Apply();
+        bBorderless &= mock.IsBorderless(desktop);
+    }
+    auto stats = reconciler.GetStats();
+    bool bMinimal = stats.frameChanges == kCalls / kResetEvery && stats.placements == kCalls / kResetEvery && stats.reverts == kCalls / kResetEvery - 1;
+    std::printf("  %-14s %6llu style writes %6llu placements %6llu frame changes, %llu reverts seen %s\n", "reconciled", static_cast<unsigned long long>(stats.styleWrites),
+        static_cast<unsigned long long>(stats.placements), static_cast<unsigned long long>(stats.frameChanges), static_cast<unsigned long long>(stats.reverts),
+        bBorderless && bMinimal ? "(match)" : "(MISMATCH)");
+
+    // Threaded: a burst of requests from the game thread becomes a few applies on the worker
+    MockWindow threaded;
+    Window::Reconciler<MockWindow> worker(threaded, std::chrono::milliseconds(20));
+    std::atomic<bool> bStop = false;
+    std::thread thread([&] {
+        while (!bStop.load())
+            worker.Next();
+    });
+    auto start = std::chrono::steady_clock::now();
+    for (int call = 0; call < 200; ++call) {
+        worker.Request(window, desktop);
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    double burstMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto threadedStats = worker.GetStats();
+    // One more request wakes the worker to see bStop
+    bStop = true;
+    worker.Request(window, desktop);
+    thread.join();
+    bool bCoalesced = threadedStats.applies < threadedStats.requests && threadedStats.applies <= static_cast<std::uint64_t>(burstMs / 20.0) + 2 && threaded.IsBorderless(desktop);
+    std::printf("  %-14s %6llu requests over %.0f ms applied %llu times, %llu frame change(s) %s\n", "coalesced", static_cast<unsigned long long>(threadedStats.requests),
+        burstMs, static_cast<unsigned long long>(threadedStats.applies), static_cast<unsigned long long>(threadedStats.frameChanges), bCoalesced ? "(match)" : "(MISMATCH)");
+}
+
+// Frame telemetry: a producer thread pushes synthetic 60 fps timestamps with a 50ms stutter every 100 frames
+// while the consumer drains and summarises them, as the render thread and the CSV thread do in the game
+void BenchTelemetry()
+{
+    constexpr std::size_t kFrames = 100000;
+    constexpr std::int64_t kFrameNs = 16'666'667;
+    constexpr std::int64_t kStutterNs = 50'000'000;
+
+    // The hot path must not allocate
+    static Telemetry::Ring<std::int64_t, 8192> ring;
+    std::int64_t timestamp;
+    std::size_t before = gAllocations.load();
+    for (std::int64_t i = 0; i < 4096; ++i)
+        ring.Push(i);
+    while (ring.Pop(timestamp)) {}
+    std::size_t allocations = gAllocations.load() - before;
+
+    std::atomic<bool> bDone = false;
+    double pushNs = 0.0;
+    std::thread producer([&] {
+        std::int64_t now = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < kFrames; ++i) {
+            now += i % 100 == 99 ? kStutterNs : kFrameNs;
+            // Back off instead of dropping so the summary below sees every frame
+            while (!ring.Push(now))
+                std::this_thread::yield();
+        }
+        pushNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kFrames;
+        bDone = true;
+    });
+
+    Telemetry::Capture capture;
+    for (;;) {
+        bool bFinished = bDone.load();
+        while (ring.Pop(timestamp))
+            capture.Add(timestamp);
+        if (bFinished)
+            break;
+        std::this_thread::yield();
+    }
+    producer.join();
+
+    Telemetry::Report report = capture.TakeReport();
+    std::size_t expectedStutters = kFrames / 100;
+    std::printf("telemetry: %zu frames, producer %.1f ns/push incl. backoff on a full ring (%zu times), %zu allocations/4096 pushes\n", capture.Frames(), pushNs,
+        ring.Dropped(), allocations);
+    std::printf("  avg %.2f fps, 1%% low %.2f fps, 0.1%% low %.2f fps, max %.2f ms, %zu stutters %s\n", report.averageFps, report.low1Fps, report.low01Fps,
+        report.maxFrameMs, report.stutters,
+        capture.Frames() == kFrames && report.stutters == expectedStutters && std::abs(report.low1Fps - 20.0) < 0.01 && std::abs(report.low01Fps - 20.0) < 0.01 ? "(match)" : "(MISMATCH)");
+}
+
+// Frame limiter on simulated time: the sleeper overshoots like a 0.5ms timer (plus rare 2ms stalls), each spin costs 50ns.
+// Compares the calibrated pacer against sleeping the whole way (no spin) and spinning the whole way (no sleep).
+void BenchFramePacer()
+{
+    constexpr double kFps = 144.0;
+    constexpr int kFrames = 20000;
+
+    struct FakeClock
+    {
+        std::int64_t now = 1;
+        std::int64_t Now() const { return now; }
+    };
+    struct FakeSleeper
+    {
+        FakeClock& clock;
+        std::mt19937 rng{ 7 };
+        std::int64_t spins = 0;
+        void Sleep(std::int64_t ns)
+        {
+            std::exponential_distribution<double> overshoot(1.0 / 400'000.0);
+            std::int64_t stall = std::uniform_int_distribution<int>(0, 99)(rng) == 0 ? 2'000'000 : 0;
+            clock.now += ns + 300'000 + static_cast<std::int64_t>(overshoot(rng)) + stall;
+        }
+        void Spin()
+        {
+            clock.now += 50;
+            ++spins;
+        }
+    };
+
+    // Runs kFrames of 2-5ms simulated work through wait, returns the share of frames within 0.05ms of the cap and of time spent spinning
+    auto run = [&](const char* label, auto&& wait, FakeClock& clock, FakeSleeper& sleeper) {
+        std::mt19937 rng(11);
+        std::uniform_int_distribution<std::int64_t> work(2'000'000, 5'000'000);
+        std::vector<double> frameMs;
+        frameMs.reserve(kFrames);
+        std::int64_t start = clock.Now();
+        std::int64_t last = 0;
+        for (int i = 0; i < kFrames; ++i) {
+            clock.now += work(rng);
+            wait();
+            if (last)
+                frameMs.push_back((clock.Now() - last) / 1'000'000.0);
+            last = clock.Now();
+        }
+        double mean = 0.0;
+        for (double ms : frameMs)
+            mean += ms;
+        mean /= frameMs.size();
+        double variance = 0.0;
+        for (double ms : frameMs)
+            variance += (ms - mean) * (ms - mean);
+        double stddev = std::sqrt(variance / frameMs.size());
+        double onTime = std::count_if(frameMs.begin(), frameMs.end(), [&](double ms) { return std::abs(ms - 1000.0 / kFps) < 0.05; }) / static_cast<double>(frameMs.size());
+        std::sort(frameMs.begin(), frameMs.end());
+        double spinShare = sleeper.spins * 50.0 / (clock.Now() - start);
+        std::printf("  %-12s mean %7.3f ms  stddev %6.3f ms  p99 %7.3f ms  on time %5.1f%%  spinning %5.1f%% of wall time\n", label, mean, stddev,
+            frameMs[frameMs.size() * 99 / 100], onTime * 100.0, spinShare * 100.0);
+        return std::pair{ onTime, spinShare };
+    };
+
+    std::printf("frame pacer: %.0f fps cap (%.3f ms), simulated clock\n", kFps, 1000.0 / kFps);
+    const std::int64_t intervalNs = static_cast<std::int64_t>(1'000'000'000.0 / kFps);
+
+    FakeClock sleepClock;
+    FakeSleeper sleepOnly{ sleepClock };
+    std::int64_t deadline = 0;
+    auto [sleepOnTime, sleepSpin] = run("sleep only", [&] {
+        std::int64_t now = sleepClock.Now();
+        if (deadline && now < deadline)
+            sleepOnly.Sleep(deadline - now);
+        deadline = (deadline && sleepClock.Now() - deadline <= intervalNs ? deadline : sleepClock.Now()) + intervalNs;
+    }, sleepClock, sleepOnly);
+
+    FakeClock spinClock;
+    FakeSleeper spinOnly{ spinClock };
+    deadline = 0;
+    auto [spinOnTime, spinSpin] = run("spin only", [&] {
+        while (deadline && spinClock.Now() < deadline)
+            spinOnly.Spin();
+        deadline = (deadline && spinClock.Now() - deadline <= intervalNs ? deadline : spinClock.Now()) + intervalNs;
+    }, spinClock, spinOnly);
+
+    FakeClock pacerClock;
+    FakeSleeper pacerSleeper{ pacerClock };
+    Pacing::FramePacer pacer(pacerClock, pacerSleeper, kFps);
+    auto [pacerOnTime, pacerSpin] = run("pacer", [&] { pacer.Wait(); }, pacerClock, pacerSleeper);
+    std::printf("  calibrated spin window %.3f ms, %llu missed deadlines %s\n", pacer.SpinWindow() / 1'000'000.0,
+        static_cast<unsigned long long>(pacer.GetStats().missed), pacerOnTime > 0.90 && pacerOnTime > sleepOnTime && pacerSpin < spinSpin / 3 ? "(match)" : "(MISMATCH)");
+    (void)spinOnTime;
+    (void)sleepSpin;
+}
+
+// Feature scheduler with stub features that sleep like a slow install: dependency order, skip propagation, cycles
+// and config gates
+void BenchFeatures()
+{
+    constexpr auto kInstall = std::chrono::milliseconds(20);
+
+    auto build = [&](Features::Scheduler& scheduler, std::vector<std::string>& order) {
+        auto install = [&](const char* name, bool bResult) {
+            return [&, name, bResult] {
+                std::this_thread::sleep_for(kInstall);
+                order.push_back(name);
+                return bResult;
+            };
+        };
+        scheduler.Add({ "Resolution", 1, 100, {}, {}, {}, install("Resolution", true) });
+        scheduler.Add({ "Pillarboxing", 1, 50, {}, { "Resolution" }, {}, install("Pillarboxing", true) });
+        scheduler.Add({ "FOV", 1, 50, {}, { "Resolution" }, {}, install("FOV", true) });
+        scheduler.Add({ "HUD", 1, 40, {}, { "Resolution" }, {}, install("HUD", true) });
+        scheduler.Add({ "Borderless", 1, 30, {}, {}, {}, install("Borderless", true) });
+        scheduler.Add({ "DrawDistance", 1, 10, {}, {}, {}, install("DrawDistance", false) });
+        scheduler.Add({ "Governor", 1, 10, {}, { "DrawDistance" }, {}, install("Governor", true) });
+        scheduler.Add({ "CycleA", 1, 0, {}, { "CycleB" }, {}, install("CycleA", true) });
+        scheduler.Add({ "CycleB", 1, 0, {}, { "CycleA" }, {}, install("CycleB", true) });
+        scheduler.Add({ "OtherGame", 2, 0, {}, {}, {}, install("OtherGame", true) });
+        scheduler.Add({ "GatedOff", 1, 0, {}, {}, [] { return false; }, install("GatedOff", true) });
+        scheduler.Add({ "NeedsGated", 1, 0, {}, { "GatedOff" }, {}, install("NeedsGated", true) });
+    };
+
+    auto indexOf = [](const std::vector<std::string>& order, const char* name) {
+        return std::find(order.begin(), order.end(), name) - order.begin();
+    };
+
+    std::printf("features: %lld ms per stub install\n", static_cast<long long>(kInstall.count()));
+    Features::Scheduler scheduler;
+    std::vector<std::string> order;
+    build(scheduler, order);
+    scheduler.Select(1);
+    auto start = std::chrono::steady_clock::now();
+    const auto& results = scheduler.Run();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    auto status = [&](const char* name) {
+        for (const auto& result : results) {
+            if (std::strcmp(result.name, name) == 0)
+                return result.status;
+        }
+        return Features::Status::Pending;
+    };
+    using Features::Status;
+    bool bOrdered = order.size() == 6 && indexOf(order, "Resolution") < indexOf(order, "Pillarboxing") && indexOf(order, "Resolution") < indexOf(order, "FOV") &&
+        indexOf(order, "Resolution") < indexOf(order, "HUD");
+    bool bStatuses = status("Pillarboxing") == Status::Installed && status("DrawDistance") == Status::Failed && status("Governor") == Status::Skipped &&
+        status("CycleA") == Status::Skipped && status("CycleB") == Status::Skipped && status("OtherGame") == Status::Disabled &&
+        status("GatedOff") == Status::Disabled && status("NeedsGated") == Status::Skipped;
+    std::printf("  %8.1f ms  order:", ms);
+    for (const auto& name : order)
+        std::printf(" %s", name.c_str());
+    std::printf(" %s\n", bOrdered && bStatuses ? "(match)" : "(MISMATCH)");
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t imageSize = 0;
+    std::size_t maxThreads = 0;
+    const char* jsonPath = nullptr;
+    std::vector<std::string> peFiles;
+    std::size_t positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "--pe") == 0 && i + 1 < argc)
+            peFiles.emplace_back(argv[++i]);
+        else if (positional++ == 0)
+            imageSize = std::strtoul(argv[i], nullptr, 10);
+        else
+            maxThreads = std::strtoul(argv[i], nullptr, 10);
+    }
+    if (imageSize == 0)
+        imageSize = 20;
+
+    BenchScanner(imageSize * 1024 * 1024);
+    BenchAnchoring(peFiles, imageSize * 1024 * 1024);
+    BenchUnpack(imageSize * 1024 * 1024);
+    BenchDiskScan(peFiles, imageSize * 1024 * 1024);
+    BenchThreads(imageSize * 1024 * 1024, maxThreads);
+    auto results = BenchHotPaths(imageSize * 1024 * 1024);
+    BenchCallbacks();
+    BenchHookStats();
+    BenchAsyncLog();
+    BenchPatch();
+    BenchArena();
+    BenchWindow();
+    BenchGovernor();
+    BenchTelemetry();
+    BenchFramePacer();
+    BenchFeatures();
+
+    if (jsonPath && !WriteJson(jsonPath, results, imageSize * 1024 * 1024)) {
+        std::printf("Failed to write %s\n", jsonPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,397 @@
+// DAFix hook trace replay. Runs a trace recorded by a DAFIX_HOOK_TRACE build of the DLL through the same Hooks:: callbacks,
+// checks every call reproduces the recorded outputs and measures callback throughput, no game or Windows required.
+// Build: g++ -std=c++23 -O2 -pthread -Isrc -Iexternal/safetyhook tools/dafix-replay.cpp -o dafix-replay
+// Usage: dafix-replay [--ulps <n>] [<trace> | --synthesize <out> [frames]]
+//   Without a trace, a synthetic one is captured from the callbacks themselves (DA1 and DA2 frames over several resolutions),
+//   which only checks the capture/replay round trip, --synthesize also writes it out.
+//   Float stack slots may differ by --ulps (default 2) since the game's CRT and this host's libm may round tanf/atanf apart.
+//   Exit code is 0 when every replayed call reproduces the recorded registers and stack slots.
+
+#include "hooks.hpp"
+#include "hooktrace.hpp"
+#include "signatures.hpp"
+
+#include <safetyhook.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using HookTrace::Record;
+    using HookTrace::Site;
+
+    constexpr std::size_t kSites = static_cast<std::size_t>(Site::Count);
+    constexpr std::size_t kListedMismatches = 8;
+    constexpr double kMinBenchSec = 0.2;       // Per site and mode, split over kBenchRounds
+    constexpr std::size_t kBenchRounds = 5;
+
+    volatile bool bResolutionChanged = false;
+
+    // The DLL's mid-hook lambdas minus the snapshot load. Site::Count does nothing, to time the replay itself.
+    template<typename Context>
+    void Call(Site site, Context& ctx, const Hooks::Resolution& resolution)
+    {
+        switch (site) {
+        case Site::CurrentResolution:
+            bResolutionChanged = Hooks::ResolutionChanged(ctx, resolution);
+            break;
+        case Site::DA1_ShadowAspectRatio:
+            Hooks::Call(&Hooks::Callbacks::shadowAspectRatio, ctx, resolution);
+            break;
+        case Site::DA1_Pillarboxing:
+        case Site::DA2_Pillarboxing:
+            Hooks::Call(&Hooks::Callbacks::pillarboxing, ctx, resolution);
+            break;
+        case Site::DialogFOV:
+            Hooks::Call(&Hooks::Callbacks::dialogFOV, ctx, resolution);
+            break;
+        case Site::DA1_HUDScale:
+            Hooks::Call(&Hooks::Callbacks::hudScale, ctx, resolution);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Snapshots published as the DLL publishes them, once per game: a synthetic trace holds calls from both, and the
+    // pillarboxing callback each is selected with differs
+    struct Snapshots
+    {
+        Hooks::ResolutionState da1;
+        Hooks::ResolutionState da2;
+
+        void Publish(int width, int height, float hudScale)
+        {
+            Hooks::Resolution resolution = Hooks::CalculateResolution(width, height, hudScale);
+            resolution.callbacks = Hooks::Select<safetyhook::Context32>(Hooks::Variant::DA1, resolution);
+            da1.Publish(resolution);
+            resolution.callbacks = Hooks::Select<safetyhook::Context32>(Hooks::Variant::DA2, resolution);
+            da2.Publish(resolution);
+        }
+
+        const Hooks::Resolution& For(Site site) const { return site == Site::DA2_Pillarboxing ? da2.Load() : da1.Load(); }
+    };
+
+    // One call rebuilt from the recorded inputs, esp pointing at a host copy of the recorded stack slots.
+    // Captured with the DLL's HookTrace::Begin/End, the stack pointer is given back as recorded.
+    Record Replay(const Record& recorded, Site site, const Hooks::Resolution& resolution)
+    {
+        alignas(16) std::array<std::uint32_t, HookTrace::kStackSlots> stack = recorded.stackBefore;
+        safetyhook::Context32 ctx = {};
+        ctx.edi = recorded.before.edi;
+        ctx.esi = recorded.before.esi;
+        ctx.edx = recorded.before.edx;
+        ctx.ecx = recorded.before.ecx;
+        ctx.ebx = recorded.before.ebx;
+        ctx.eax = recorded.before.eax;
+        ctx.ebp = recorded.before.ebp;
+        ctx.esp = reinterpret_cast<std::uintptr_t>(stack.data());
+
+        Record replayed;
+        HookTrace::Begin(replayed, recorded.site, ctx);
+        Call(site, ctx, resolution);
+        HookTrace::End(replayed, ctx);
+        replayed.time = recorded.time;
+        replayed.thread = recorded.thread;
+        replayed.before.esp = recorded.before.esp;
+        replayed.after.esp = recorded.before.esp;
+        return replayed;
+    }
+
+    // Stack slots the callbacks write floats to
+    unsigned FloatSlots(Site site)
+    {
+        switch (site) {
+        case Site::DA1_ShadowAspectRatio:
+        case Site::DialogFOV:
+            return 1u << 3;
+        case Site::DA1_HUDScale:
+            return 1u << 2;
+        default:
+            return 0;
+        }
+    }
+
+    std::uint32_t UlpDistance(std::uint32_t a, std::uint32_t b)
+    {
+        // Map float bits onto a monotonic integer line so neighbouring floats are 1 apart across zero too
+        auto ordered = [](std::uint32_t bits) -> std::int64_t {
+            return bits & 0x8000'0000u ? -static_cast<std::int64_t>(bits & 0x7FFF'FFFFu) : static_cast<std::int64_t>(bits);
+        };
+        return static_cast<std::uint32_t>(std::llabs(ordered(a) - ordered(b)));
+    }
+
+    // Exact registers, exact stack slots except floats within ulps. bRounded is set when a float slot matched only within ulps.
+    bool Matches(const Record& recorded, const Record& replayed, std::uint32_t ulps, bool& bRounded)
+    {
+        if (!(replayed.after == recorded.after))
+            return false;
+        if (!recorded.before.esp)
+            return true;
+        unsigned floats = FloatSlots(recorded.site);
+        for (std::size_t slot = 0; slot < HookTrace::kStackSlots; ++slot) {
+            std::uint32_t expected = recorded.stackAfter[slot];
+            std::uint32_t actual = replayed.stackAfter[slot];
+            if (expected == actual)
+                continue;
+            if (!(floats & (1u << slot)) || UlpDistance(expected, actual) > ulps)
+                return false;
+            bRounded = true;
+        }
+        return true;
+    }
+
+    void PrintRecord(const char* label, const HookTrace::Registers& regs, const std::array<std::uint32_t, HookTrace::kStackSlots>& stack)
+    {
+        std::printf("      %-8s eax %08x ebx %08x ecx %08x edx %08x ebp %08x esi %08x edi %08x esp %08x | %08x %08x %08x %08x\n", label,
+            regs.eax, regs.ebx, regs.ecx, regs.edx, regs.ebp, regs.esi, regs.edi, regs.esp, stack[0], stack[1], stack[2], stack[3]);
+    }
+
+    std::uint32_t Bits(float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    // Game-like calls over a few resolution changes, outputs captured by replaying each call as it is generated
+    HookTrace::Trace Synthesize(std::size_t frames)
+    {
+        struct Mode
+        {
+            int width;
+            int height;
+        };
+        constexpr Mode kModes[] = { { 1920, 1080 }, { 2560, 1080 }, { 3440, 1440 }, { 1280, 1024 }, { 5760, 1080 } };
+        constexpr float kFovs[] = { 45.0f, 50.0f, 55.0f, 60.0f, 70.0f };
+
+        HookTrace::Trace trace;
+        trace.header.recordSize = sizeof(Record);
+        trace.header.game = Signatures::kDA1 | Signatures::kDA2;
+        Snapshots snapshots;
+        std::mt19937 engine(2024);
+        auto rng = [&] { return static_cast<std::uint32_t>(engine()); };
+        std::uint64_t time = 0;
+        float fov = kFovs[0];
+
+        auto add = [&](Site site, const HookTrace::Registers& regs, const std::array<std::uint32_t, HookTrace::kStackSlots>& stack) {
+            Record record;
+            record.site = site;
+            record.time = time;
+            record.before = regs;
+            record.stackBefore = stack;
+            Record replayed = Replay(record, site, snapshots.For(site));
+            record.after = replayed.after;
+            record.stackAfter = replayed.stackAfter;
+            trace.records.push_back(record);
+            time += 2000 + rng() % 3000;
+        };
+        auto registers = [&](std::uint32_t eax, std::uint32_t ecx) {
+            return HookTrace::Registers{ rng(), rng(), rng(), ecx, rng(), eax, rng(), 0x0019'F000u - (rng() % 256) * 16 };
+        };
+
+        for (std::size_t frame = 0; frame < frames; ++frame) {
+            const Mode& mode = kModes[frame * std::size(kModes) / frames];
+            if (snapshots.da1.Load().width != mode.width || snapshots.da1.Load().height != mode.height) {
+                Record resolution;
+                resolution.site = Site::Resolution;
+                resolution.time = time;
+                resolution.before.eax = static_cast<std::uint32_t>(mode.width);
+                resolution.before.ecx = static_cast<std::uint32_t>(mode.height);
+                resolution.after = resolution.before;
+                trace.records.push_back(resolution);
+                snapshots.Publish(mode.width, mode.height, trace.header.hudScale);
+            }
+
+            // Dialog cameras hold a FOV for a while and cut to the next
+            if (frame % 40 == 0)
+                fov = kFovs[rng() % std::size(kFovs)];
+            add(Site::CurrentResolution, registers(mode.width, mode.height), {});
+            add(Site::DialogFOV, registers(rng(), rng()), { rng(), rng(), rng(), Bits(fov) });
+            add(Site::DA1_ShadowAspectRatio, registers(rng(), rng()), { rng(), rng(), rng(), Bits(1.5f + (rng() % 100) / 100.0f) });
+            add(Site::DA1_HUDScale, registers(rng(), rng()), { rng(), rng(), Bits(1.0f), rng() });
+            if (frame % 4 == 0) {
+                std::uint32_t width = static_cast<std::uint32_t>(mode.height) * 4 / 3;
+                add(Site::DA1_Pillarboxing, registers(rng(), rng()), { (static_cast<std::uint32_t>(mode.width) - width) / 2, 0, width, static_cast<std::uint32_t>(mode.height) });
+                add(Site::DA2_Pillarboxing, registers(rng(), rng()), {});
+            }
+            time += 16'600'000;
+        }
+        return trace;
+    }
+
+    struct Timing
+    {
+        double ns = 0.0;                // Best ns per call, restoring the call's inputs included
+        std::uint64_t checksum = 0;     // Sum of every output register and stack slot, printed so no call can be dropped
+    };
+
+    // Best ns per call over a few rounds of calling site on each recorded input in turn. Inputs are prepared up front and
+    // the stack slots restored before every call, so each call does what it did in the game.
+    Timing Throughput(const HookTrace::Trace& trace, const std::vector<const Hooks::Resolution*>& resolutions, const std::vector<std::size_t>& indices, Site site)
+    {
+        struct Call
+        {
+            safetyhook::Context32 ctx = {};
+            alignas(16) std::array<std::uint32_t, HookTrace::kStackSlots> stack = {};
+            const Record* record = nullptr;
+            const Hooks::Resolution* resolution = nullptr;
+        };
+        std::vector<Call> calls(indices.size());
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            Call& call = calls[i];
+            call.record = &trace.records[indices[i]];
+            call.resolution = resolutions[indices[i]];
+            const HookTrace::Registers& regs = call.record->before;
+            call.ctx.edi = regs.edi;
+            call.ctx.esi = regs.esi;
+            call.ctx.edx = regs.edx;
+            call.ctx.ecx = regs.ecx;
+            call.ctx.ebx = regs.ebx;
+            call.ctx.eax = regs.eax;
+            call.ctx.ebp = regs.ebp;
+            call.ctx.esp = reinterpret_cast<std::uintptr_t>(call.stack.data());
+        }
+
+        Timing timing;
+        for (std::size_t round = 0; round < kBenchRounds; ++round) {
+            std::size_t count = 0;
+            auto start = std::chrono::steady_clock::now();
+            double elapsed = 0.0;
+            do {
+                for (Call& call : calls) {
+                    call.stack = call.record->stackBefore;
+                    ::Call(site, call.ctx, *call.resolution);
+                    timing.checksum += call.ctx.ebx + call.ctx.ebp + call.ctx.ecx + call.ctx.edx;
+                    for (std::uint32_t slot : call.stack)
+                        timing.checksum += slot;
+                }
+                count += calls.size();
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            } while (elapsed < kMinBenchSec / kBenchRounds);
+            double ns = elapsed * 1e9 / count;
+            timing.ns = round == 0 ? ns : std::min(timing.ns, ns);
+        }
+        timing.checksum += bResolutionChanged;
+        return timing;
+    }
+
+    const char* GameName(std::uint32_t game)
+    {
+        if (game == Signatures::kDA1)
+            return "DA1";
+        if (game == Signatures::kDA2)
+            return "DA2";
+        return game ? "DA1/DA2" : "unknown";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::uint32_t ulps = 2;
+    const char* tracePath = nullptr;
+    const char* synthesizePath = nullptr;
+    std::size_t frames = 20000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--ulps" && i + 1 < argc)
+            ulps = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--synthesize" && i + 1 < argc) {
+            synthesizePath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                frames = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else
+            tracePath = argv[i];
+    }
+
+    HookTrace::Trace trace;
+    if (tracePath) {
+        auto loaded = HookTrace::Load(tracePath);
+        if (!loaded) {
+            std::fprintf(stderr, "%s: not a DAFix hook trace (version %u)\n", tracePath, HookTrace::kVersion);
+            return 1;
+        }
+        trace = std::move(*loaded);
+    }
+    else {
+        trace = Synthesize(frames);
+        if (synthesizePath && !HookTrace::Save(synthesizePath, trace)) {
+            std::fprintf(stderr, "%s: write failed\n", synthesizePath);
+            return 1;
+        }
+    }
+
+    // Snapshot in effect at each record, published where the DLL published it
+    Snapshots snapshots;
+    std::vector<const Hooks::Resolution*> resolutions;
+    resolutions.reserve(trace.records.size());
+    std::size_t changes = 0;
+    for (const auto& record : trace.records) {
+        if (record.site == Site::Resolution) {
+            snapshots.Publish(static_cast<int>(record.before.eax), static_cast<int>(record.before.ecx), trace.header.hudScale);
+            ++changes;
+        }
+        resolutions.push_back(&snapshots.For(record.site));
+    }
+    // Threads' records interleave in drain order, so the last one isn't necessarily the latest
+    std::uint64_t lastTime = 0;
+    for (const auto& record : trace.records)
+        lastTime = std::max(lastTime, record.time);
+    double seconds = lastTime / 1e9;
+    std::printf("trace: %s, game %s, hud scale %g, %zu records over %.1fs, %zu resolution snapshots\n", tracePath ? tracePath : synthesizePath ? synthesizePath : "(synthetic)",
+        GameName(trace.header.game), trace.header.hudScale, trace.records.size(), seconds, changes);
+
+    // Verify: every call, in trace order, once
+    std::array<std::vector<std::size_t>, kSites> bySite;
+    std::array<std::size_t, kSites> matched = {};
+    std::array<std::size_t, kSites> rounded = {};
+    std::size_t listed = 0;
+    for (std::size_t i = 0; i < trace.records.size(); ++i) {
+        const Record& recorded = trace.records[i];
+        auto index = static_cast<std::size_t>(recorded.site);
+        if (recorded.site == Site::Resolution || index >= kSites)
+            continue;
+        bySite[index].push_back(i);
+        Record replayed = Replay(recorded, recorded.site, *resolutions[i]);
+        bool bRounded = false;
+        if (Matches(recorded, replayed, ulps, bRounded)) {
+            ++matched[index];
+            rounded[index] += bRounded ? 1 : 0;
+        }
+        else if (listed++ < kListedMismatches) {
+            std::printf("  mismatch: record %zu, %s at %.6fs, %dx%d\n", i, HookTrace::Name(recorded.site), recorded.time / 1e9, resolutions[i]->width, resolutions[i]->height);
+            PrintRecord("input", recorded.before, recorded.stackBefore);
+            PrintRecord("recorded", recorded.after, recorded.stackAfter);
+            PrintRecord("replayed", replayed.after, replayed.stackAfter);
+        }
+    }
+
+    // Throughput of each site's recorded calls, and the same loop calling nothing for what restoring the inputs costs.
+    // ns/call and Mcalls/s come from the same timing.
+    bool bClean = true;
+    std::printf("  %-24s %10s %10s %10s %10s %10s %10s %18s\n", "site", "calls", "matched", "rounded", "ns/call", "Mcalls/s", "loop ns", "checksum");
+    for (std::size_t index = 1; index < kSites; ++index) {
+        const auto& indices = bySite[index];
+        if (indices.empty())
+            continue;
+        auto site = static_cast<Site>(index);
+        Timing loop = Throughput(trace, resolutions, indices, Site::Count);
+        Timing timing = Throughput(trace, resolutions, indices, site);
+        bool bMatched = matched[index] == indices.size();
+        bClean &= bMatched;
+        std::printf("  %-24s %10zu %10zu %10zu %10.2f %10.1f %10.2f %18llx %s\n", HookTrace::Name(site), indices.size(), matched[index], rounded[index],
+            timing.ns, 1e3 / timing.ns, loop.ns, static_cast<unsigned long long>(timing.checksum), bMatched ? "(match)" : "(MISMATCH)");
+    }
+    std::printf("  ns/call and Mcalls/s include restoring each call's inputs, loop ns is that alone\n");
+    return bClean ? 0 : 1;
+}
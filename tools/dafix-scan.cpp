@@ -0,0 +1,150 @@
+// DAFix offline signature scanner. Maps game executables from disk and reports every hit of every DAFix signature.
+// Build: g++ -std=c++20 -O2 -pthread -Isrc tools/dafix-scan.cpp -o dafix-scan
+// Usage: dafix-scan [--all] <exe>...
+//   Signatures are picked by file name (DAOrigins.exe / DragonAge2.exe), --all or an unknown name scans for every signature.
+//   Exit code is 0 when, in every file, no signature has more than one hit and each feature has at least one (alternatives may miss).
+
+#include "mappedfile.hpp"
+#include "pe.hpp"
+#include "signatures.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t kMaxListedHits = 8;
+
+    std::string Lower(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    unsigned GameFromName(const std::filesystem::path& path)
+    {
+        std::string name = Lower(path.filename().string());
+        if (name == "daorigins.exe")
+            return Signatures::kDA1;
+        if (name == "dragonage2.exe")
+            return Signatures::kDA2;
+        return 0;
+    }
+
+    std::string GameNames(unsigned games)
+    {
+        std::string names;
+        if (games & Signatures::kDA1)
+            names += "DA1";
+        if (games & Signatures::kDA2)
+            names += names.empty() ? "DA2" : "+DA2";
+        return names;
+    }
+
+    // Every match of pattern in the file's code sections, as RVAs
+    std::vector<std::uint32_t> FindAll(const MappedFile& file, const PE::Layout& layout, const Scanner::PatternView& signature, const Scanner::Profile& profile)
+    {
+        // Anchored on the signature's rarest bytes in this file
+        Scanner::PatternView pattern = Scanner::Anchor(signature, profile);
+        std::vector<std::uint32_t> hits;
+        for (const auto& range : layout.FileRanges(PE::Region::Code, file.Size())) {
+            const std::uint8_t* begin = file.Data() + range.offset;
+            const std::uint8_t* end = begin + range.size;
+            for (const std::uint8_t* current = begin; current < end;) {
+                const std::uint8_t* result = Scanner::Find(current, end - current, pattern);
+                if (!result)
+                    break;
+                if (auto rva = layout.OffsetToRva(static_cast<std::uint32_t>(result - file.Data())))
+                    hits.push_back(*rva);
+                current = result + 1;
+            }
+        }
+        std::sort(hits.begin(), hits.end());
+        return hits;
+    }
+
+    // Returns true if no signature is ambiguous and every feature resolved
+    bool ScanFile(const std::filesystem::path& path, bool bAll)
+    {
+        MappedFile file(path);
+        if (!file) {
+            std::printf("%s: failed to map file\n", path.string().c_str());
+            return false;
+        }
+        auto layout = PE::Parse(file.Data(), file.Size());
+        if (!layout) {
+            std::printf("%s: not a PE image\n", path.string().c_str());
+            return false;
+        }
+
+        unsigned games = bAll ? 0 : GameFromName(path);
+        std::printf("%s: %zu bytes, timestamp 0x%08x, image base 0x%llx, %s, scanner %s\n", path.string().c_str(), file.Size(), layout->timestamp,
+            static_cast<unsigned long long>(layout->imageBase), games ? GameNames(games).c_str() : "all signatures", Scanner::LevelName(Scanner::SupportedLevel()));
+
+        bool bClean = true;
+        std::vector<std::string> features;
+        std::vector<std::string> resolved;
+        auto total = std::chrono::steady_clock::now();
+        Scanner::Profile profile;
+        for (const auto& range : layout->FileRanges(PE::Region::Code, file.Size()))
+            profile.Sample(file.Data() + range.offset, range.size);
+
+        for (const auto& entry : Signatures::kAll) {
+            if (games && !(entry.games & games))
+                continue;
+
+            auto start = std::chrono::steady_clock::now();
+            auto hits = FindAll(file, *layout, entry.pattern, profile);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            const char* status = hits.size() == 1 ? "ok" : hits.empty() ? "missing" : "NON-UNIQUE";
+            if (hits.size() > 1)
+                bClean = false;
+            features.push_back(entry.feature);
+            if (!hits.empty())
+                resolved.push_back(entry.feature);
+            std::printf("  %-28s %-7s %3zu hit(s) %8.3f ms  %-10s", entry.name, GameNames(entry.games).c_str(), hits.size(), ms, status);
+            for (std::size_t i = 0; i < hits.size() && i < kMaxListedHits; ++i)
+                std::printf(" 0x%08x", hits[i]);
+            if (hits.size() > kMaxListedHits)
+                std::printf(" ...");
+            std::printf("\n");
+        }
+        for (const auto& feature : features) {
+            if (std::find(resolved.begin(), resolved.end(), feature) == resolved.end()) {
+                std::printf("  %s: no signature matched\n", feature.c_str());
+                bClean = false;
+                resolved.push_back(feature);
+            }
+        }
+        double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - total).count();
+        std::printf("  total %.3f ms\n", totalMs);
+        return bClean;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool bAll = false;
+    std::vector<std::filesystem::path> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--all") == 0)
+            bAll = true;
+        else
+            paths.emplace_back(argv[i]);
+    }
+    if (paths.empty()) {
+        std::printf("Usage: dafix-scan [--all] <exe>...\n");
+        return 2;
+    }
+
+    bool bClean = true;
+    for (const auto& path : paths)
+        bClean &= ScanFile(path, bAll);
+    return bClean ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+// DAFix stub checker. Encodes every register/stack patch stub with the bundled Zydis, decodes it back and checks it, no game required.
+// Build: gcc -c -O2 -Iexternal/safetyhook external/safetyhook/Zydis.c -o Zydis.o
+//        g++ -std=c++23 -O2 -Isrc -Iexternal/safetyhook tools/dafix-stubs.cpp Zydis.o -o dafix-stubs
+// Usage: dafix-stubs
+//   Exit code is 0 when Zydis.o matches Zydis.h, every stub encodes and passes Stubs::Check(), and every deliberately broken copy fails it.
+//   Each listing ends with the stub's bytes, which can be decoded independently of Zydis:
+//   echo "<bytes>" | llvm-mc --disassemble -triple=i386
+
+#include "stubs.hpp"
+
+#include <cstdio>
+#include <span>
+#include <vector>
+
+namespace
+{
+    struct Site
+    {
+        const char* name;
+        std::span<const Stubs::Store> stores;
+    };
+
+    const Site kSites[] = {
+        { "DA1_Pillarboxing", Stubs::kDA1_Pillarboxing },
+        { "DA2_Pillarboxing", Stubs::kDA2_Pillarboxing },
+        { "DA1_HUDScale", Stubs::kHUDScale },
+    };
+
+    // Addresses above 2GB so sign-extended displacements are covered too
+    constexpr Stubs::Layout kLayout = { 0x8040'1000, 0x0050'2000 };
+
+    void PrintListing(const std::vector<std::uint8_t>& code)
+    {
+        ZydisDecoder decoder;
+        ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LEGACY_32, ZYDIS_STACK_WIDTH_32);
+        for (std::size_t offset = 0; offset < code.size();) {
+            ZydisDecodedInstruction instruction;
+            if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&decoder, nullptr, code.data() + offset, code.size() - offset, &instruction)))
+                break;
+            std::printf("    %04zx ", offset);
+            for (std::size_t i = 0; i < 8; ++i)
+                i < instruction.length ? std::printf("%02x ", code[offset + i]) : std::printf("   ");
+            std::printf(" %s\n", ZydisMnemonicGetString(instruction.mnemonic));
+            offset += instruction.length;
+        }
+        std::printf("    bytes:");
+        for (std::uint8_t byte : code)
+            std::printf(" 0x%02x", byte);
+        std::printf("\n");
+    }
+
+    // Copies of code that must fail Check(): each byte flipped in turn catches wrong slots, registers and targets,
+    // a truncated copy catches a missing jmp
+    std::size_t CountAccepted(const std::vector<std::uint8_t>& code, std::span<const Stubs::Store> stores, std::size_t& variants)
+    {
+        std::size_t accepted = 0;
+        for (std::size_t i = 0; i < code.size(); ++i) {
+            auto broken = code;
+            broken[i] ^= 0x01;
+            ++variants;
+            if (Stubs::Check(broken, stores, kLayout))
+                ++accepted;
+        }
+        std::vector<std::uint8_t> truncated(code.begin(), code.end() - 1);
+        ++variants;
+        if (Stubs::Check(truncated, stores, kLayout))
+            ++accepted;
+        return accepted;
+    }
+}
+
+int main()
+{
+    // The stubs are only as good as the encoder that built them, so name it
+    ZyanU64 version = ZydisGetVersion();
+    bool bClean = version == ZYDIS_VERSION;
+    std::printf("Zydis %u.%u.%u %s\n", ZYDIS_VERSION_MAJOR(version), ZYDIS_VERSION_MINOR(version), ZYDIS_VERSION_PATCH(version),
+        bClean ? "(match)" : "(MISMATCH with Zydis.h)");
+    for (const auto& site : kSites) {
+        auto code = Stubs::Encode(site.stores, kLayout);
+        bool bChecked = !code.empty() && Stubs::Check(code, site.stores, kLayout);
+        std::printf("%-20s %2zu store(s) %3zu bytes %s\n", site.name, site.stores.size(), code.size(), bChecked ? "(match)" : "(MISMATCH)");
+        PrintListing(code);
+        bClean &= bChecked;
+        if (!bChecked)
+            continue;
+
+        // A flipped bit can still be a valid stub (e.g. a flipped immediate), those are reported but not failures
+        std::size_t variants = 0;
+        std::size_t accepted = CountAccepted(code, site.stores, variants);
+        std::printf("    %zu of %zu corrupted copies rejected\n", variants - accepted, variants);
+    }
+
+    // Stores a stub can't express must be refused rather than encoded wrong
+    const Stubs::Store kEsp[] = { { Stubs::Register(ZYDIS_REGISTER_ESP), Stubs::Constant(0) } };
+    bool bRefused = Stubs::Encode(kEsp, kLayout).empty();
+    std::printf("%-20s %s\n", "esp destination", bRefused ? "refused (match)" : "encoded (MISMATCH)");
+    bClean &= bRefused;
+
+    return bClean ? 0 : 1;
+}